@@ -0,0 +1,325 @@
+// Benchmark.cpp - Microbenchmarks for the simulator building blocks
+//
+// Built and run by `make bench`. Prints one CSV row per benchmark and size:
+//
+//   benchmark,n,unit,runs,ns_per_run,ns_per_unit,units_per_sec,allocs_per_run,alloc_bytes_per_run
+//
+// ns_per_unit and units_per_sec divide by n (devices, users, appends or
+// bytes, see unit); allocation counts cover the timed part only. Everything
+// runs on the calling thread so numbers from different builds compare.
+#include "NetworkSimulation.h"
+#include "ConfigParser.h"
+#include "CellTower.h"
+#include "CharBuffer.h"
+#include "GenerationTraits.h"
+#include "Capacity.h"
+#include "basicIO.h"
+#include "Instrumentation.h"
+
+// Allocations are counted by the operator new replacement in
+// Instrumentation.cpp, compiled in with this flag
+#ifndef SIM_COUNT_ALLOCATIONS
+#error "Build the benchmarks with -DSIM_COUNT_ALLOCATIONS (see make bench)"
+#endif
+
+extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
+
+#define SYS_OPEN 2
+#define SYS_CLOSE 3
+#define SYS_LSEEK 8
+#define SYS_CLOCK_GETTIME 228
+#define CLOCK_MONOTONIC 1
+#define O_RDONLY 0
+#define SEEK_END 2
+#define STDOUT 1
+
+// Each benchmark repeats until it has run this long (and at least twice)
+#define BENCH_MIN_NS 200000000ull
+#define BENCH_MIN_RUNS 2
+#define BENCH_MAX_RUNS 100000
+
+static const unsigned int BENCH_SIZES[] = {1000, 10000, 100000, 1000000, 10000000};
+
+// ---------------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------------
+
+struct Sample {
+    unsigned long long ns;
+    unsigned long long allocations;
+    unsigned long long bytes;
+};
+
+struct TimeSpec {
+    long seconds;
+    long nanoseconds;
+};
+
+static unsigned long long nowNs() {
+    TimeSpec ts;
+    syscall3(SYS_CLOCK_GETTIME, CLOCK_MONOTONIC, (long)&ts, 0);
+    return (unsigned long long)ts.seconds * 1000000000ull + (unsigned long long)ts.nanoseconds;
+}
+
+// Brackets the timed part of one run; setup and teardown stay outside
+class Stopwatch {
+private:
+    Sample begin;
+
+public:
+    void start() {
+        begin.allocations = Instrumentation::total(COUNTER_ALLOCATIONS);
+        begin.bytes = Instrumentation::total(COUNTER_ALLOCATED_BYTES);
+        begin.ns = nowNs();
+    }
+
+    Sample stop() const {
+        Sample s;
+        s.ns = nowNs() - begin.ns;
+        s.allocations = Instrumentation::total(COUNTER_ALLOCATIONS) - begin.allocations;
+        s.bytes = Instrumentation::total(COUNTER_ALLOCATED_BYTES) - begin.bytes;
+        return s;
+    }
+};
+
+static void appendNumber(CharBuffer& out, unsigned long long value) {
+    char digits[24];
+    unsigned int len = 0;
+    do {
+        digits[sizeof(digits) - 1 - len++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    out.append(digits + sizeof(digits) - len, len);
+}
+
+// value / divisor with two decimals
+static void appendRatio(CharBuffer& out, unsigned long long value, unsigned long long divisor) {
+    unsigned long long hundredths = (value * 100 + divisor / 2) / divisor;
+    appendNumber(out, hundredths / 100);
+    out.append(".");
+    if (hundredths % 100 < 10) out.append("0");
+    appendNumber(out, hundredths % 100);
+}
+
+// run() performs one repetition and returns its Sample
+template<typename Run>
+static void measure(const char* name, unsigned int n, const char* unit, Run run) {
+    Sample total = {0, 0, 0};
+    unsigned long long runs = 0;
+    while (runs < BENCH_MIN_RUNS || (total.ns < BENCH_MIN_NS && runs < BENCH_MAX_RUNS)) {
+        Sample s = run();
+        total.ns += s.ns;
+        total.allocations += s.allocations;
+        total.bytes += s.bytes;
+        runs++;
+    }
+    if (total.ns == 0) total.ns = 1;
+
+    const unsigned long long units = runs * n;
+    CharBuffer row;
+    row.append(name);
+    row.append(",");
+    appendNumber(row, n);
+    row.append(",");
+    row.append(unit);
+    row.append(",");
+    appendNumber(row, runs);
+    row.append(",");
+    appendRatio(row, total.ns, runs);
+    row.append(",");
+    appendRatio(row, total.ns, units);
+    row.append(",");
+    appendNumber(row, (units * 1000000000ull) / total.ns);
+    row.append(",");
+    appendRatio(row, total.allocations, runs);
+    row.append(",");
+    appendRatio(row, total.bytes, runs);
+    row.newline();
+    row.writeTo(STDOUT);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static void benchCreateUserDevices(unsigned int n) {
+    measure("createUserDevices", n, "device", [n]() {
+        Stopwatch watch;
+        watch.start();
+        DevicePool* devices = createUserDevices(n, 10);
+        Sample s = watch.stop();
+        delete devices;
+        return s;
+    });
+}
+
+// One device at a time into an empty 4G-shaped tower with room for all
+static void benchAssignFirstAvailable(unsigned int n) {
+    const unsigned int usersPerChannel = 30;
+    const unsigned int antennas = 4;
+    const unsigned int channelBw = 10;
+    const unsigned int channels = (n + usersPerChannel * antennas - 1) / (usersPerChannel * antennas);
+
+    measure("assignDeviceToFirstAvailable", n, "device", [=]() {
+        DevicePool* devices = createUserDevices(n, 10);
+        Core4G* core = new Core4G(1, n, antennas);
+        CellTower* tower = new CellTower(1, core, devices, channels * channelBw, channelBw,
+                                         usersPerChannel, antennas);
+
+        Stopwatch watch;
+        watch.start();
+        for (unsigned int i = 0; i < n; ++i) {
+            tower->assignDeviceToFirstAvailable(i);
+        }
+        Sample s = watch.stop();
+
+        delete tower;
+        delete core;
+        delete devices;
+        return s;
+    });
+}
+
+static unsigned int fileSize(const char* path) {
+    long fd = syscall3(SYS_OPEN, (long)path, O_RDONLY, 0);
+    if (fd < 0) throw "Cannot open configuration file";
+    long size = syscall3(SYS_LSEEK, fd, 0, SEEK_END);
+    syscall3(SYS_CLOSE, fd, 0, 0);
+    return (size > 0) ? (unsigned int)size : 1;
+}
+
+static void benchParseFile(const char* path) {
+    measure("ConfigParser::parseFile", fileSize(path), "byte", [path]() {
+        Stopwatch watch;
+        watch.start();
+        SimulationConfig config = ConfigParser::parseFile(path);
+        Sample s = watch.stop();
+        (void)config;
+        return s;
+    });
+}
+
+static void benchCharBufferAppend(unsigned int n) {
+    measure("CharBuffer::append", n, "append", [n]() {
+        CharBuffer* out = new CharBuffer();
+
+        Stopwatch watch;
+        watch.start();
+        for (unsigned int i = 0; i < n; ++i) {
+            if (i & 1) {
+                out->append(i);
+            } else {
+                out->append("Users: ");
+            }
+        }
+        Sample s = watch.stop();
+
+        delete out;
+        return s;
+    });
+}
+
+// The generation's config from the file, widened so the tower (and for
+// 2G/3G its single core) accepts all n users
+template<unsigned int Generation>
+static typename GenerationTraits<Generation>::Config scaledConfig(const SimulationConfig& base,
+                                                                  unsigned int n,
+                                                                  unsigned int& coreCapacity) {
+    typedef GenerationTraits<Generation> Traits;
+    typename Traits::Config cfg = Traits::config(base);
+    cfg.users = n;
+
+    unsigned int perChannel = Traits::usersPerChannel(cfg) * Traits::mimoFactor(cfg);
+    if (perChannel == 0) perChannel = 1;
+    const unsigned int channels = (n + perChannel - 1) / perChannel;
+    if (Traits::CHANNELIZATION == CHANNEL_PER_MHZ) {
+        cfg.bandwidth = channels * 1000;
+    } else {
+        if (cfg.channelBw == 0) cfg.channelBw = 1;
+        cfg.bandwidth = channels * cfg.channelBw;
+    }
+
+    coreCapacity = base.coreCapacity;
+    if (!Traits::MULTI_CORE) {
+        const CapacityResult cap = computeCapacity<Generation>(cfg, coreCapacity);
+        unsigned long long needed = (unsigned long long)n * (cap.effectiveMsgs ? cap.effectiveMsgs : 1);
+        coreCapacity = (needed > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (unsigned int)needed;
+    }
+    return cfg;
+}
+
+// A whole report captured into a CharBuffer, as for option 5; the lazy
+// placement derives the devices instead of materializing them
+template<unsigned int Generation>
+static void benchSimulateCaptured(const SimulationConfig& base, unsigned int n,
+                                  DevicePlacement placement = PLACEMENT_MATERIALIZED) {
+    unsigned int coreCapacity = 0;
+    const typename GenerationTraits<Generation>::Config cfg = scaledConfig<Generation>(base, n, coreCapacity);
+
+    char captured[] = "simulateGeneration<NG>Captured";
+    char lazy[] = "simulateGeneration<NG>Lazy";
+    char* name = (placement == PLACEMENT_LAZY) ? lazy : captured;
+    name[19] = GenerationTraits<Generation>::NAME[0];
+
+    EngineOptions options;
+    options.placement = placement;
+
+    measure(name, n, "user", [&]() {
+        CharBuffer* out = new CharBuffer();
+
+        Stopwatch watch;
+        watch.start();
+        simulateGeneration<Generation>(cfg, coreCapacity, *out, options);
+        Sample s = watch.stop();
+
+        delete out;
+        return s;
+    });
+}
+
+static unsigned int parseLimit(const char* text) {
+    unsigned long value = 0;
+    while (*text >= '0' && *text <= '9') {
+        value = value * 10 + (*text - '0');
+        if (value > 0xFFFFFFFFul) return 0xFFFFFFFFu;
+        text++;
+    }
+    return (unsigned int)value;
+}
+
+// Usage: simulator_bench [config-file] [max-users]
+int main(int argc, char* argv[]) {
+    const char* configFile = (argc > 1) ? argv[1] : "input.txt";
+    const unsigned int maxUsers = (argc > 2) ? parseLimit(argv[2]) : 0xFFFFFFFFu;
+
+    try {
+        const SimulationConfig base = ConfigParser::parseFile(configFile);
+
+        CharBuffer header;
+        header.append("benchmark,n,unit,runs,ns_per_run,ns_per_unit,units_per_sec,"
+                      "allocs_per_run,alloc_bytes_per_run");
+        header.newline();
+        header.writeTo(STDOUT);
+
+        benchParseFile(configFile);
+
+        for (unsigned int size : BENCH_SIZES) {
+            if (size > maxUsers) break;
+            benchCreateUserDevices(size);
+            benchAssignFirstAvailable(size);
+            benchCharBufferAppend(size);
+            benchSimulateCaptured<2>(base, size);
+            benchSimulateCaptured<3>(base, size);
+            benchSimulateCaptured<4>(base, size);
+            benchSimulateCaptured<5>(base, size);
+            benchSimulateCaptured<5>(base, size, PLACEMENT_LAZY);
+        }
+    } catch (const char* error) {
+        io.errorstring("\nException caught: ");
+        io.errorstring(error);
+        io.terminate();
+        return 1;
+    }
+
+    return 0;
+}
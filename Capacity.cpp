@@ -0,0 +1,72 @@
+// Capacity.cpp
+#include "Capacity.h"
+#include "Instrumentation.h"
+
+// Degenerate configurations (zero bandwidth, messages or core capacity)
+// yield zero instead of dividing by zero, so sweeps can cross them safely.
+
+static void finishAdmission(CapacityResult& r, unsigned int users) {
+    r.towerCapacity = (r.frequencyLimit < r.multiCoreLimit) ? r.frequencyLimit : r.multiCoreLimit;
+    r.accepted = (users <= r.towerCapacity) ? users : r.towerCapacity;
+    r.rejected = (users > r.towerCapacity) ? (users - r.towerCapacity) : 0;
+}
+
+// 2G/3G: a single core; its limit uses the rounded message count
+static void applySingleCore(CapacityResult& r, unsigned int overhead, unsigned int coreCapacity) {
+    r.effectiveMsgsFloat = (r.messagesPerUser * (100.0 + overhead)) / 100.0;
+    r.effectiveMsgs = (unsigned int)(r.effectiveMsgsFloat + 0.5);
+    r.coreLimit = (r.effectiveMsgs > 0) ? coreCapacity / r.effectiveMsgs : 0;
+    r.coresNeeded = 1;
+    r.multiCoreLimit = r.coreLimit;
+}
+
+// 4G/5G: as many cores as the frequency limit requires
+static void applyMultiCore(CapacityResult& r, unsigned int overhead, unsigned int coreCapacity) {
+    r.effectiveMsgsFloat = (r.messagesPerUser * (100.0 + overhead)) / 100.0;
+    r.effectiveMsgs = (unsigned int)(r.effectiveMsgsFloat + 0.5);
+    
+    if (r.effectiveMsgsFloat > 0.0 && coreCapacity > 0) {
+        r.coreLimit = (unsigned int)(coreCapacity / r.effectiveMsgsFloat);
+        r.coresNeeded = (unsigned int)((r.frequencyLimit * r.effectiveMsgsFloat / coreCapacity) + 0.999);
+    } else {
+        r.coreLimit = 0;
+        r.coresNeeded = 0;
+    }
+    r.multiCoreLimit = r.coreLimit * r.coresNeeded;
+}
+
+CapacityResult computeCapacityPoint(const CapacityInput& in, bool perMHz, bool multiCore) {
+    CapacityResult r;
+    if (perMHz) {
+        r.numChannels = in.bandwidth / 1000;
+    } else {
+        r.numChannels = (in.channelBw > 0) ? in.bandwidth / in.channelBw : 0;
+    }
+    
+    r.usersPerChannel = in.usersPerChannel * in.mimo;
+    r.baseUsers = r.numChannels * in.usersPerChannel;
+    r.frequencyLimit = r.baseUsers * in.mimo;
+    r.messagesPerUser = in.messagesPerUser;
+    
+    if (multiCore) {
+        applyMultiCore(r, in.overhead, in.coreCapacity);
+    } else {
+        applySingleCore(r, in.overhead, in.coreCapacity);
+    }
+    finishAdmission(r, in.users);
+    return r;
+}
+
+template<unsigned int Generation>
+CapacityResult computeCapacity(const typename GenerationTraits<Generation>::Config& cfg,
+                               unsigned int coreCapacity) {
+    typedef GenerationTraits<Generation> Traits;
+    SIM_TIME_PHASE(PHASE_CAPACITY);
+    return computeCapacityPoint(capacityInput<Generation>(cfg, coreCapacity),
+                                Traits::CHANNELIZATION == CHANNEL_PER_MHZ, Traits::MULTI_CORE);
+}
+
+template CapacityResult computeCapacity<2>(const Config2G&, unsigned int);
+template CapacityResult computeCapacity<3>(const Config3G&, unsigned int);
+template CapacityResult computeCapacity<4>(const Config4G&, unsigned int);
+template CapacityResult computeCapacity<5>(const Config5G&, unsigned int);
@@ -0,0 +1,67 @@
+// Capacity.h
+#ifndef CAPACITY_H
+#define CAPACITY_H
+
+#include "GenerationTraits.h"
+
+// Everything the capacity analysis derives from one generation's config.
+// Pure arithmetic with no allocation, shared by the simulation reports and
+// the parameter sweep.
+struct CapacityResult {
+    unsigned int numChannels;       // Channels (5G: bandwidth in MHz)
+    unsigned int usersPerChannel;   // Including MIMO antennas
+    unsigned int baseUsers;         // numChannels x base users, before MIMO
+    unsigned int frequencyLimit;
+    unsigned int messagesPerUser;
+    double effectiveMsgsFloat;
+    unsigned int effectiveMsgs;
+    unsigned int coreLimit;         // Users a single core can serve
+    unsigned int coresNeeded;
+    unsigned int multiCoreLimit;
+    unsigned int towerCapacity;
+    unsigned int accepted;
+    unsigned int rejected;
+};
+
+// The configuration fields the analysis reads, after GenerationTraits has
+// mapped a generation's config onto them
+struct CapacityInput {
+    unsigned int users;
+    unsigned int bandwidth;
+    unsigned int channelBw;         // Unused with per-MHz channelization
+    unsigned int usersPerChannel;   // Before MIMO
+    unsigned int mimo;
+    unsigned int messagesPerUser;
+    unsigned int overhead;
+    unsigned int coreCapacity;
+};
+
+// Generation-independent arithmetic of one point. This is the reference
+// definition: the vector kernels in CapacityBatch fall back to it and must
+// reproduce it bit for bit.
+CapacityResult computeCapacityPoint(const CapacityInput& in, bool perMHz, bool multiCore);
+
+// The fields of one generation's config, as read by the engine
+template<unsigned int Generation>
+CapacityInput capacityInput(const typename GenerationTraits<Generation>::Config& cfg,
+                            unsigned int coreCapacity) {
+    typedef GenerationTraits<Generation> Traits;
+    CapacityInput in;
+    in.users = cfg.users;
+    in.bandwidth = cfg.bandwidth;
+    in.channelBw = cfg.channelBw;
+    in.usersPerChannel = Traits::usersPerChannel(cfg);
+    in.mimo = Traits::mimoFactor(cfg);
+    in.messagesPerUser = Traits::messagesPerUser(cfg);
+    in.overhead = cfg.overhead;
+    in.coreCapacity = coreCapacity;
+    return in;
+}
+
+// One engine for every generation; GenerationTraits<G> supplies the
+// channelization, MIMO factor and core model. Instantiated for 2G - 5G.
+template<unsigned int Generation>
+CapacityResult computeCapacity(const typename GenerationTraits<Generation>::Config& cfg,
+                               unsigned int coreCapacity);
+
+#endif
@@ -0,0 +1,414 @@
+// CapacityBatch.cpp
+#include "CapacityBatch.h"
+#include "Instrumentation.h"
+#include <immintrin.h>
+
+#define INPUT_ARRAYS 8
+#define OUTPUT_ARRAYS 11
+
+// The vector kernels keep every 32-bit value in its own 64-bit lane, the
+// layout of a double lane. Unsigned values convert to double exactly by
+// placing them in the mantissa of 2^52, and a truncated double converts
+// back the same way; the low 32 bits are then what (unsigned int)x yields
+// in the scalar code. That is exact up to 2^52, so steps holding a larger
+// intermediate are recomputed by the scalar code.
+#define TWO_POW_52 4503599627370496.0
+#define TWO_POW_52_BITS 0x4330000000000000ll
+#define LOW_32_BITS 0xFFFFFFFFll
+
+// Raw array pointers handed to the kernels
+struct BatchView {
+    const unsigned int* users;
+    const unsigned int* bandwidth;
+    const unsigned int* channelBw;
+    const unsigned int* usersPerChannel;
+    const unsigned int* mimo;
+    const unsigned int* messagesPerUser;
+    const unsigned int* overhead;
+    const unsigned int* coreCapacity;
+
+    double* effectiveMsgsFloat;
+    unsigned int* numChannels;
+    unsigned int* mimoUsersPerChannel;
+    unsigned int* baseUsers;
+    unsigned int* frequencyLimit;
+    unsigned int* effectiveMsgs;
+    unsigned int* coreLimit;
+    unsigned int* coresNeeded;
+    unsigned int* multiCoreLimit;
+    unsigned int* towerCapacity;
+    unsigned int* accepted;
+    unsigned int* rejected;
+
+    explicit BatchView(const CapacityBatch& b)
+        : users(b.users), bandwidth(b.bandwidth), channelBw(b.channelBw),
+          usersPerChannel(b.usersPerChannel), mimo(b.mimo), messagesPerUser(b.messagesPerUser),
+          overhead(b.overhead), coreCapacity(b.coreCapacity),
+          effectiveMsgsFloat(b.effectiveMsgsFloat), numChannels(b.numChannels),
+          mimoUsersPerChannel(b.mimoUsersPerChannel), baseUsers(b.baseUsers),
+          frequencyLimit(b.frequencyLimit), effectiveMsgs(b.effectiveMsgs), coreLimit(b.coreLimit),
+          coresNeeded(b.coresNeeded), multiCoreLimit(b.multiCoreLimit),
+          towerCapacity(b.towerCapacity), accepted(b.accepted), rejected(b.rejected) {}
+};
+
+static void computeScalar(const BatchView& v, unsigned int first, unsigned int last,
+                          bool perMHz, bool multiCore) {
+    for (unsigned int i = first; i < last; ++i) {
+        CapacityInput in;
+        in.users = v.users[i];
+        in.bandwidth = v.bandwidth[i];
+        in.channelBw = v.channelBw[i];
+        in.usersPerChannel = v.usersPerChannel[i];
+        in.mimo = v.mimo[i];
+        in.messagesPerUser = v.messagesPerUser[i];
+        in.overhead = v.overhead[i];
+        in.coreCapacity = v.coreCapacity[i];
+
+        const CapacityResult r = computeCapacityPoint(in, perMHz, multiCore);
+        v.numChannels[i] = r.numChannels;
+        v.mimoUsersPerChannel[i] = r.usersPerChannel;
+        v.baseUsers[i] = r.baseUsers;
+        v.frequencyLimit[i] = r.frequencyLimit;
+        v.effectiveMsgsFloat[i] = r.effectiveMsgsFloat;
+        v.effectiveMsgs[i] = r.effectiveMsgs;
+        v.coreLimit[i] = r.coreLimit;
+        v.coresNeeded[i] = r.coresNeeded;
+        v.multiCoreLimit[i] = r.multiCoreLimit;
+        v.towerCapacity[i] = r.towerCapacity;
+        v.accepted[i] = r.accepted;
+        v.rejected[i] = r.rejected;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE4.1: two points per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("sse4.1")))
+static inline __m128i loadSse(const unsigned int* p) {
+    return _mm_cvtepu32_epi64(_mm_loadl_epi64((const __m128i*)p));
+}
+
+__attribute__((target("sse4.1")))
+static inline void storeSse(unsigned int* p, __m128i v) {
+    _mm_storel_epi64((__m128i*)p, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 2, 0)));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128d toDoubleSse(__m128i v) {
+    const __m128i bias = _mm_set1_epi64x(TWO_POW_52_BITS);
+    return _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(v, bias)), _mm_set1_pd(TWO_POW_52));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i truncSse(__m128d x) {
+    __m128d whole = _mm_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m128i bits = _mm_castpd_si128(_mm_add_pd(whole, _mm_set1_pd(TWO_POW_52)));
+    return _mm_and_si128(bits, _mm_set1_epi64x(LOW_32_BITS));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i mulLowSse(__m128i a, __m128i b) {
+    return _mm_and_si128(_mm_mul_epu32(a, b), _mm_set1_epi64x(LOW_32_BITS));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i nonZeroSse(__m128i v) {
+    return _mm_xor_si128(_mm_cmpeq_epi64(v, _mm_setzero_si128()), _mm_set1_epi64x(-1));
+}
+
+template<bool PerMHz, bool MultiCore>
+__attribute__((target("sse4.1")))
+static unsigned int computeSse41(const BatchView& v, unsigned int first, unsigned int last) {
+    const __m128d limit = _mm_set1_pd(TWO_POW_52);
+    unsigned int i = first;
+    for (; i + 2 <= last; i += 2) {
+        __m128i users = loadSse(v.users + i);
+        __m128i bandwidth = loadSse(v.bandwidth + i);
+        __m128i usersPerChannel = loadSse(v.usersPerChannel + i);
+        __m128i mimo = loadSse(v.mimo + i);
+        __m128i coreCapacity = loadSse(v.coreCapacity + i);
+
+        __m128i channels;
+        if (PerMHz) {
+            channels = truncSse(_mm_div_pd(toDoubleSse(bandwidth), _mm_set1_pd(1000.0)));
+        } else {
+            __m128i channelBw = loadSse(v.channelBw + i);
+            channels = _mm_and_si128(truncSse(_mm_div_pd(toDoubleSse(bandwidth), toDoubleSse(channelBw))),
+                                     nonZeroSse(channelBw));
+        }
+        __m128i mimoUsers = mulLowSse(usersPerChannel, mimo);
+        __m128i baseUsers = mulLowSse(channels, usersPerChannel);
+        __m128i frequencyLimit = mulLowSse(baseUsers, mimo);
+
+        __m128d messages = _mm_mul_pd(toDoubleSse(loadSse(v.messagesPerUser + i)),
+                                      _mm_add_pd(_mm_set1_pd(100.0), toDoubleSse(loadSse(v.overhead + i))));
+        __m128d effectiveFloat = _mm_div_pd(messages, _mm_set1_pd(100.0));
+        __m128d rounded = _mm_add_pd(effectiveFloat, _mm_set1_pd(0.5));
+        __m128d exact = _mm_cmplt_pd(rounded, limit);
+        __m128i effective = truncSse(rounded);
+
+        __m128i coreLimit;
+        __m128i coresNeeded;
+        __m128i multiCoreLimit;
+        if (MultiCore) {
+            __m128d valid = _mm_and_pd(_mm_cmpgt_pd(effectiveFloat, _mm_setzero_pd()),
+                                       _mm_castsi128_pd(nonZeroSse(coreCapacity)));
+            __m128d capacity = toDoubleSse(coreCapacity);
+            __m128d cores = _mm_add_pd(_mm_div_pd(_mm_mul_pd(toDoubleSse(frequencyLimit), effectiveFloat), capacity),
+                                       _mm_set1_pd(0.999));
+            __m128d invalid = _mm_xor_pd(valid, _mm_castsi128_pd(_mm_set1_epi64x(-1)));
+            exact = _mm_and_pd(exact, _mm_or_pd(_mm_cmplt_pd(cores, limit), invalid));
+            coreLimit = _mm_and_si128(truncSse(_mm_div_pd(capacity, effectiveFloat)), _mm_castpd_si128(valid));
+            coresNeeded = _mm_and_si128(truncSse(cores), _mm_castpd_si128(valid));
+            multiCoreLimit = mulLowSse(coreLimit, coresNeeded);
+        } else {
+            coreLimit = _mm_and_si128(truncSse(_mm_div_pd(toDoubleSse(coreCapacity), toDoubleSse(effective))),
+                                      nonZeroSse(effective));
+            coresNeeded = _mm_set1_epi64x(1);
+            multiCoreLimit = coreLimit;
+        }
+
+        if (_mm_movemask_pd(exact) != 0x3) {
+            computeScalar(v, i, i + 2, PerMHz, MultiCore);
+            continue;
+        }
+
+        __m128i towerCapacity = _mm_min_epu32(frequencyLimit, multiCoreLimit);
+        __m128i accepted = _mm_min_epu32(users, towerCapacity);
+
+        storeSse(v.numChannels + i, channels);
+        storeSse(v.mimoUsersPerChannel + i, mimoUsers);
+        storeSse(v.baseUsers + i, baseUsers);
+        storeSse(v.frequencyLimit + i, frequencyLimit);
+        _mm_storeu_pd(v.effectiveMsgsFloat + i, effectiveFloat);
+        storeSse(v.effectiveMsgs + i, effective);
+        storeSse(v.coreLimit + i, coreLimit);
+        storeSse(v.coresNeeded + i, coresNeeded);
+        storeSse(v.multiCoreLimit + i, multiCoreLimit);
+        storeSse(v.towerCapacity + i, towerCapacity);
+        storeSse(v.accepted + i, accepted);
+        storeSse(v.rejected + i, _mm_sub_epi64(users, accepted));
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: four points per step, same steps as above
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static inline __m256i loadAvx2(const unsigned int* p) {
+    return _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)p));
+}
+
+__attribute__((target("avx2")))
+static inline void storeAvx2(unsigned int* p, __m256i v) {
+    const __m256i evenLanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    _mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, evenLanes)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d toDoubleAvx2(__m256i v) {
+    const __m256i bias = _mm256_set1_epi64x(TWO_POW_52_BITS);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(v, bias)), _mm256_set1_pd(TWO_POW_52));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i truncAvx2(__m256d x) {
+    __m256d whole = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256i bits = _mm256_castpd_si256(_mm256_add_pd(whole, _mm256_set1_pd(TWO_POW_52)));
+    return _mm256_and_si256(bits, _mm256_set1_epi64x(LOW_32_BITS));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mulLowAvx2(__m256i a, __m256i b) {
+    return _mm256_and_si256(_mm256_mul_epu32(a, b), _mm256_set1_epi64x(LOW_32_BITS));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i nonZeroAvx2(__m256i v) {
+    return _mm256_xor_si256(_mm256_cmpeq_epi64(v, _mm256_setzero_si256()), _mm256_set1_epi64x(-1));
+}
+
+template<bool PerMHz, bool MultiCore>
+__attribute__((target("avx2")))
+static unsigned int computeAvx2(const BatchView& v, unsigned int first, unsigned int last) {
+    const __m256d limit = _mm256_set1_pd(TWO_POW_52);
+    unsigned int i = first;
+    for (; i + 4 <= last; i += 4) {
+        __m256i users = loadAvx2(v.users + i);
+        __m256i bandwidth = loadAvx2(v.bandwidth + i);
+        __m256i usersPerChannel = loadAvx2(v.usersPerChannel + i);
+        __m256i mimo = loadAvx2(v.mimo + i);
+        __m256i coreCapacity = loadAvx2(v.coreCapacity + i);
+
+        __m256i channels;
+        if (PerMHz) {
+            channels = truncAvx2(_mm256_div_pd(toDoubleAvx2(bandwidth), _mm256_set1_pd(1000.0)));
+        } else {
+            __m256i channelBw = loadAvx2(v.channelBw + i);
+            channels = _mm256_and_si256(truncAvx2(_mm256_div_pd(toDoubleAvx2(bandwidth), toDoubleAvx2(channelBw))),
+                                        nonZeroAvx2(channelBw));
+        }
+        __m256i mimoUsers = mulLowAvx2(usersPerChannel, mimo);
+        __m256i baseUsers = mulLowAvx2(channels, usersPerChannel);
+        __m256i frequencyLimit = mulLowAvx2(baseUsers, mimo);
+
+        __m256d messages = _mm256_mul_pd(toDoubleAvx2(loadAvx2(v.messagesPerUser + i)),
+                                         _mm256_add_pd(_mm256_set1_pd(100.0), toDoubleAvx2(loadAvx2(v.overhead + i))));
+        __m256d effectiveFloat = _mm256_div_pd(messages, _mm256_set1_pd(100.0));
+        __m256d rounded = _mm256_add_pd(effectiveFloat, _mm256_set1_pd(0.5));
+        __m256d exact = _mm256_cmp_pd(rounded, limit, _CMP_LT_OQ);
+        __m256i effective = truncAvx2(rounded);
+
+        __m256i coreLimit;
+        __m256i coresNeeded;
+        __m256i multiCoreLimit;
+        if (MultiCore) {
+            __m256d valid = _mm256_and_pd(_mm256_cmp_pd(effectiveFloat, _mm256_setzero_pd(), _CMP_GT_OQ),
+                                          _mm256_castsi256_pd(nonZeroAvx2(coreCapacity)));
+            __m256d capacity = toDoubleAvx2(coreCapacity);
+            __m256d cores = _mm256_add_pd(_mm256_div_pd(_mm256_mul_pd(toDoubleAvx2(frequencyLimit), effectiveFloat), capacity),
+                                          _mm256_set1_pd(0.999));
+            __m256d invalid = _mm256_xor_pd(valid, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)));
+            exact = _mm256_and_pd(exact, _mm256_or_pd(_mm256_cmp_pd(cores, limit, _CMP_LT_OQ), invalid));
+            coreLimit = _mm256_and_si256(truncAvx2(_mm256_div_pd(capacity, effectiveFloat)), _mm256_castpd_si256(valid));
+            coresNeeded = _mm256_and_si256(truncAvx2(cores), _mm256_castpd_si256(valid));
+            multiCoreLimit = mulLowAvx2(coreLimit, coresNeeded);
+        } else {
+            coreLimit = _mm256_and_si256(truncAvx2(_mm256_div_pd(toDoubleAvx2(coreCapacity), toDoubleAvx2(effective))),
+                                         nonZeroAvx2(effective));
+            coresNeeded = _mm256_set1_epi64x(1);
+            multiCoreLimit = coreLimit;
+        }
+
+        if (_mm256_movemask_pd(exact) != 0xF) {
+            computeScalar(v, i, i + 4, PerMHz, MultiCore);
+            continue;
+        }
+
+        __m256i towerCapacity = _mm256_min_epu32(frequencyLimit, multiCoreLimit);
+        __m256i accepted = _mm256_min_epu32(users, towerCapacity);
+
+        storeAvx2(v.numChannels + i, channels);
+        storeAvx2(v.mimoUsersPerChannel + i, mimoUsers);
+        storeAvx2(v.baseUsers + i, baseUsers);
+        storeAvx2(v.frequencyLimit + i, frequencyLimit);
+        _mm256_storeu_pd(v.effectiveMsgsFloat + i, effectiveFloat);
+        storeAvx2(v.effectiveMsgs + i, effective);
+        storeAvx2(v.coreLimit + i, coreLimit);
+        storeAvx2(v.coresNeeded + i, coresNeeded);
+        storeAvx2(v.multiCoreLimit + i, multiCoreLimit);
+        storeAvx2(v.towerCapacity + i, towerCapacity);
+        storeAvx2(v.accepted + i, accepted);
+        storeAvx2(v.rejected + i, _mm256_sub_epi64(users, accepted));
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+
+static CapacityKernel selectedKernel = KERNEL_AUTO;
+
+static CapacityKernel detectKernel() {
+    if (__builtin_cpu_supports("avx2")) return KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return KERNEL_SSE41;
+    return KERNEL_SCALAR;
+}
+
+static CapacityKernel bestKernel() {
+    static const CapacityKernel detected = detectKernel();
+    return detected;
+}
+
+void CapacityBatch::setKernel(CapacityKernel kernel) {
+    CapacityKernel best = bestKernel();
+    if ((kernel == KERNEL_AVX2 && best != KERNEL_AVX2) ||
+        (kernel == KERNEL_SSE41 && best == KERNEL_SCALAR)) {
+        throw "Requested capacity kernel is not supported by this CPU";
+    }
+    selectedKernel = kernel;
+}
+
+CapacityKernel CapacityBatch::getKernel() {
+    return (selectedKernel == KERNEL_AUTO) ? bestKernel() : selectedKernel;
+}
+
+const char* CapacityBatch::getKernelName(CapacityKernel kernel) {
+    switch (kernel) {
+        case KERNEL_SCALAR: return "scalar";
+        case KERNEL_SSE41: return "sse4";
+        case KERNEL_AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+CapacityBatch::CapacityBatch(unsigned int cap) : capacity(cap) {
+    arena = new unsigned int[(unsigned long)cap * (INPUT_ARRAYS + OUTPUT_ARRAYS)];
+    effectiveMsgsFloat = new double[cap];
+
+    unsigned int* next = arena;
+    unsigned int** arrays[INPUT_ARRAYS + OUTPUT_ARRAYS] = {
+        &users, &bandwidth, &channelBw, &usersPerChannel, &mimo, &messagesPerUser, &overhead,
+        &coreCapacity, &numChannels, &mimoUsersPerChannel, &baseUsers, &frequencyLimit,
+        &effectiveMsgs, &coreLimit, &coresNeeded, &multiCoreLimit, &towerCapacity, &accepted,
+        &rejected
+    };
+    for (unsigned int a = 0; a < INPUT_ARRAYS + OUTPUT_ARRAYS; ++a) {
+        *arrays[a] = next;
+        next += cap;
+    }
+}
+
+CapacityBatch::~CapacityBatch() {
+    delete[] arena;
+    delete[] effectiveMsgsFloat;
+}
+
+template<bool PerMHz, bool MultiCore>
+static unsigned int computeVector(CapacityKernel kernel, const BatchView& v,
+                                  unsigned int first, unsigned int last) {
+    switch (kernel) {
+        case KERNEL_AVX2: return computeAvx2<PerMHz, MultiCore>(v, first, last);
+        case KERNEL_SSE41: return computeSse41<PerMHz, MultiCore>(v, first, last);
+        default: return first;
+    }
+}
+
+void CapacityBatch::compute(unsigned int first, unsigned int count, bool perMHz, bool multiCore) {
+    SIM_TIME_PHASE(PHASE_CAPACITY);
+    const BatchView v(*this);
+    const CapacityKernel kernel = getKernel();
+    const unsigned int last = first + count;
+
+    unsigned int done;
+    if (perMHz) {
+        done = multiCore ? computeVector<true, true>(kernel, v, first, last)
+                         : computeVector<true, false>(kernel, v, first, last);
+    } else {
+        done = multiCore ? computeVector<false, true>(kernel, v, first, last)
+                         : computeVector<false, false>(kernel, v, first, last);
+    }
+
+    // Whatever does not fill a whole vector
+    computeScalar(v, done, last, perMHz, multiCore);
+}
+
+CapacityResult CapacityBatch::getResult(unsigned int index) const {
+    CapacityResult r;
+    r.numChannels = numChannels[index];
+    r.usersPerChannel = mimoUsersPerChannel[index];
+    r.baseUsers = baseUsers[index];
+    r.frequencyLimit = frequencyLimit[index];
+    r.messagesPerUser = messagesPerUser[index];
+    r.effectiveMsgsFloat = effectiveMsgsFloat[index];
+    r.effectiveMsgs = effectiveMsgs[index];
+    r.coreLimit = coreLimit[index];
+    r.coresNeeded = coresNeeded[index];
+    r.multiCoreLimit = multiCoreLimit[index];
+    r.towerCapacity = towerCapacity[index];
+    r.accepted = accepted[index];
+    r.rejected = rejected[index];
+    return r;
+}
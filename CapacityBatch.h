@@ -0,0 +1,89 @@
+// CapacityBatch.h
+#ifndef CAPACITYBATCH_H
+#define CAPACITYBATCH_H
+
+#include "Capacity.h"
+
+enum CapacityKernel {
+    KERNEL_AUTO,        // Widest kernel the CPU supports
+    KERNEL_SCALAR,
+    KERNEL_SSE41,       // Two points per step
+    KERNEL_AVX2         // Four points per step
+};
+
+// Capacity analysis of many points at once. Inputs and outputs are kept as
+// a structure of arrays in one allocation, so the vector kernels load
+// several points per instruction. The kernel is chosen at runtime; every
+// kernel reproduces computeCapacityPoint bit for bit, including the +0.5
+// and +0.999 rounding, and points a kernel cannot represent exactly are
+// handed to the scalar code.
+class CapacityBatch {
+private:
+    unsigned int* arena;
+    double* effectiveMsgsFloat;
+    unsigned int capacity;
+
+    // Inputs
+    unsigned int* users;
+    unsigned int* bandwidth;
+    unsigned int* channelBw;
+    unsigned int* usersPerChannel;
+    unsigned int* mimo;
+    unsigned int* messagesPerUser;
+    unsigned int* overhead;
+    unsigned int* coreCapacity;
+
+    // Outputs
+    unsigned int* numChannels;
+    unsigned int* mimoUsersPerChannel;
+    unsigned int* baseUsers;
+    unsigned int* frequencyLimit;
+    unsigned int* effectiveMsgs;
+    unsigned int* coreLimit;
+    unsigned int* coresNeeded;
+    unsigned int* multiCoreLimit;
+    unsigned int* towerCapacity;
+    unsigned int* accepted;
+    unsigned int* rejected;
+
+    friend struct BatchView;
+
+public:
+    explicit CapacityBatch(unsigned int cap);
+    ~CapacityBatch();
+
+    CapacityBatch(const CapacityBatch&) = delete;
+    CapacityBatch& operator=(const CapacityBatch&) = delete;
+
+    unsigned int getCapacity() const { return capacity; }
+
+    void setPoint(unsigned int index, const CapacityInput& in) {
+        users[index] = in.users;
+        bandwidth[index] = in.bandwidth;
+        channelBw[index] = in.channelBw;
+        usersPerChannel[index] = in.usersPerChannel;
+        mimo[index] = in.mimo;
+        messagesPerUser[index] = in.messagesPerUser;
+        overhead[index] = in.overhead;
+        coreCapacity[index] = in.coreCapacity;
+    }
+
+    // Analyses points first..first+count-1 with the active kernel
+    void compute(unsigned int first, unsigned int count, bool perMHz, bool multiCore);
+
+    template<unsigned int Generation>
+    void compute(unsigned int first, unsigned int count) {
+        compute(first, count, GenerationTraits<Generation>::CHANNELIZATION == CHANNEL_PER_MHZ,
+                GenerationTraits<Generation>::MULTI_CORE);
+    }
+
+    CapacityResult getResult(unsigned int index) const;
+
+    // The kernel used by every batch; set once before any batch runs.
+    // Throws if the CPU lacks the requested instructions.
+    static void setKernel(CapacityKernel kernel);
+    static CapacityKernel getKernel();
+    static const char* getKernelName(CapacityKernel kernel);
+};
+
+#endif
@@ -2,6 +2,12 @@
 #include "CellTower.h"
 #include "StringUtils.h"
 #include "basicIO.h"
+#include "OutputSink.h"
+#include "ThreadPool.h"
+#include "Instrumentation.h"
+
+// Devices per parallel fill task; smaller towers are filled inline
+#define FILL_CHUNK_DEVICES 16384
 
 template<typename T>
 void Channel<T>::displayChannelInfo() const {
@@ -19,23 +25,37 @@ void Channel<T>::displayChannelInfo() const {
     io.terminate();
 }
 
-template class Channel<UserDevice>;
+template class Channel<DevicePool>;
 
 void CellTower::setupChannels(unsigned int bandwidth, unsigned int usersPerChannel, unsigned int antennas) {
-    channelCount = totalBandwidth / bandwidth;
-    channels = new Channel<UserDevice>*[channelCount];
+    channelCount = channelsInBand(totalBandwidth, bandwidth);
+    channels = new Channel<DevicePool>*[channelCount];
     
     for (unsigned int i = 0; i < channelCount; ++i) {
         unsigned int freqStart = i * bandwidth;
-        channels[i] = new Channel<UserDevice>(i, freqStart, bandwidth, usersPerChannel, antennas);
+        channels[i] = new Channel<DevicePool>(i, devices, freqStart, bandwidth, usersPerChannel, antennas,
+                                              antennaPolicy);
+    }
+    
+    openWordCount = (channelCount + 63) / 64;
+    openChannels = new unsigned long long[openWordCount];
+    for (unsigned int w = 0; w < openWordCount; ++w) {
+        openChannels[w] = 0;
+    }
+    for (unsigned int i = 0; i < channelCount; ++i) {
+        if (channels[i]->getMaxUsers() > 0) {
+            openChannels[i / 64] |= 1ULL << (i % 64);
+        }
     }
+    firstOpenWord = 0;
 }
 
-CellTower::CellTower(unsigned int id, CellularCore* cellCore,
+CellTower::CellTower(unsigned int id, CellularCore* cellCore, DevicePool* devicePool,
                      unsigned int bandwidth, unsigned int channelBandwidth, 
-                     unsigned int usersPerChannel, unsigned int antennas) 
-    : towerId(id), core(cellCore), channels(nullptr), channelCount(0),
-      totalBandwidth(bandwidth), maxUsersPerChannel(usersPerChannel), antennaCount(antennas) {
+                     unsigned int usersPerChannel, unsigned int antennas, AntennaPolicy policy) 
+    : towerId(id), core(cellCore), devices(devicePool), channels(nullptr), channelCount(0),
+      totalBandwidth(bandwidth), maxUsersPerChannel(usersPerChannel), antennaCount(antennas),
+      currentLoad(0), antennaPolicy(policy), openChannels(nullptr), openWordCount(0), firstOpenWord(0) {
     
     setupChannels(channelBandwidth, usersPerChannel, antennas);
 }
@@ -47,148 +67,413 @@ CellTower::~CellTower() {
         }
         delete[] channels;
     }
+    delete[] openChannels;
 }
 
-bool CellTower::assignDeviceToChannel(UserDevice* device, unsigned int channelIndex) {
-    if (channelIndex >= channelCount || !device) {
+bool CellTower::assignDeviceToChannel(unsigned int deviceIndex, unsigned int channelIndex) {
+    if (channelIndex >= channelCount || deviceIndex >= devices->getCount()) {
         return false;
     }
     
-    if (channels[channelIndex]->assignDevice(device)) {
-        device->assignToChannel(channelIndex, channels[channelIndex]->getFrequencyStart());
-        device->activate();
+    Channel<DevicePool>* channel = channels[channelIndex];
+    unsigned int slot = channel->assignDevice(deviceIndex);
+    if (slot != NO_DEVICE) {
+        devices->assignToChannel(deviceIndex, channelIndex, channel->getFrequencyStart(), slot);
+        devices->activate(deviceIndex);
+        currentLoad++;
+        
+        if (channel->getCurrentUsers() == channel->getMaxUsers()) {
+            openChannels[channelIndex / 64] &= ~(1ULL << (channelIndex % 64));
+        }
         return true;
     }
     return false;
 }
 
-bool CellTower::assignDeviceToFirstAvailable(UserDevice* device) {
-    for (unsigned int i = 0; i < channelCount; ++i) {
-        if (assignDeviceToChannel(device, i)) {
-            return true;
-        }
+int CellTower::findFirstOpenChannel() {
+    SIM_COUNT(COUNTER_CHANNEL_WORDS_SCANNED, 1);
+    while (firstOpenWord < openWordCount && openChannels[firstOpenWord] == 0) {
+        firstOpenWord++;
+        SIM_COUNT(COUNTER_CHANNEL_WORDS_SCANNED, 1);
     }
-    return false;
+    if (firstOpenWord == openWordCount) {
+        return -1;
+    }
+    return (int)(firstOpenWord * 64 + __builtin_ctzll(openChannels[firstOpenWord]));
 }
 
-unsigned int CellTower::getTotalCapacity() const {
-    return channelCount * maxUsersPerChannel * antennaCount;
+bool CellTower::assignDeviceToFirstAvailable(unsigned int deviceIndex) {
+    int channelIndex = findFirstOpenChannel();
+    if (channelIndex < 0) {
+        return false;
+    }
+    return assignDeviceToChannel(deviceIndex, (unsigned int)channelIndex);
+}
+
+// Frees the device's slot in O(1) and reopens its channel, so the next
+// first-fit admission finds it through the bitmaps without a rescan
+bool CellTower::releaseDevice(unsigned int deviceIndex) {
+    if (deviceIndex >= devices->getCount() || !devices->isActive(deviceIndex)) {
+        return false;
+    }
+    
+    unsigned int channelIndex = devices->getAssignedChannel(deviceIndex);
+    if (channelIndex >= channelCount) {
+        return false;
+    }
+    
+    // A device active on another tower of a shared pool is not ours
+    Channel<DevicePool>* channel = channels[channelIndex];
+    unsigned int slot = devices->getAssignedSlot(deviceIndex);
+    if (channel->getDevice(slot) != deviceIndex || !channel->releaseSlot(slot)) {
+        return false;
+    }
+    
+    devices->deactivate(deviceIndex);
+    currentLoad--;
+    
+    unsigned int word = channelIndex / 64;
+    openChannels[word] |= 1ULL << (channelIndex % 64);
+    if (word < firstOpenWord) {
+        firstOpenWord = word;
+    }
+    return true;
+}
+
+// Fills whole channels in order with consecutive devices. Channels own
+// disjoint device ranges, so chunks can run concurrently; the shared load
+// counter and open-channel bitmap are fixed up by the caller.
+void CellTower::fillChannels(unsigned int firstChannel, unsigned int lastChannel,
+                             unsigned int firstDevice, unsigned int deviceCount) {
+    unsigned int perChannel = maxUsersPerChannel * antennaCount;
+    for (unsigned int c = firstChannel; c < lastChannel; ++c) {
+        Channel<DevicePool>* channel = channels[c];
+        unsigned int begin = c * perChannel;
+        unsigned int end = begin + perChannel;
+        if (end > deviceCount) end = deviceCount;
+        
+        for (unsigned int d = begin; d < end; ++d) {
+            unsigned int deviceIndex = firstDevice + d;
+            unsigned int slot = channel->assignDevice(deviceIndex);
+            devices->assignToChannel(deviceIndex, c, channel->getFrequencyStart(), slot);
+            devices->activate(deviceIndex);
+        }
+    }
 }
 
-unsigned int CellTower::getCurrentLoad() const {
-    unsigned int total = 0;
+void CellTower::refreshOpenChannels() {
+    for (unsigned int w = 0; w < openWordCount; ++w) {
+        openChannels[w] = 0;
+    }
     for (unsigned int i = 0; i < channelCount; ++i) {
-        total += channels[i]->getCurrentUsers();
+        if (channels[i]->getCurrentUsers() < channels[i]->getMaxUsers()) {
+            openChannels[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    firstOpenWord = 0;
+}
+
+// Admits count consecutive devices first-fit and returns how many fit.
+// An empty tower is filled channel by channel in parallel chunks, which
+// gives exactly the placement the one-by-one path would produce.
+unsigned int CellTower::admitDevices(unsigned int firstDevice, unsigned int count, ThreadPool* pool) {
+    unsigned int perChannel = maxUsersPerChannel * antennaCount;
+    if (pool == nullptr || currentLoad != 0 || perChannel == 0 || count < 2 * FILL_CHUNK_DEVICES) {
+        unsigned int admitted = 0;
+        while (admitted < count && assignDeviceToFirstAvailable(firstDevice + admitted)) {
+            admitted++;
+        }
+        return admitted;
+    }
+    
+    if (firstDevice >= devices->getCount()) {
+        return 0;
+    }
+    
+    unsigned int capacity = getTotalCapacity();
+    unsigned int admitted = (count < capacity) ? count : capacity;
+    if (firstDevice + admitted > devices->getCount()) {
+        admitted = devices->getCount() - firstDevice;
     }
-    return total;
+    
+    unsigned int usedChannels = (admitted + perChannel - 1) / perChannel;
+    unsigned int channelsPerChunk = FILL_CHUNK_DEVICES / perChannel;
+    if (channelsPerChunk == 0) channelsPerChunk = 1;
+    
+    pool->parallelFor(0, usedChannels, channelsPerChunk,
+                      [this, firstDevice, admitted](unsigned long long first, unsigned long long last) {
+        fillChannels((unsigned int)first, (unsigned int)last, firstDevice, admitted);
+    });
+    
+    currentLoad = admitted;
+    refreshOpenChannels();
+    return admitted;
 }
 
-Channel<UserDevice>* CellTower::getChannel(unsigned int index) const {
+unsigned int CellTower::getTotalCapacity() const {
+    return channelCount * maxUsersPerChannel * antennaCount;
+}
+
+Channel<DevicePool>* CellTower::getChannel(unsigned int index) const {
     if (index < channelCount) {
         return channels[index];
     }
     return nullptr;
 }
 
-void CellTower::displayTowerInfo() const {
-    io.outputstring("\n--- Tower Status ---");
-    io.terminate();
-    io.outputstring("Tower ID: ");
-    io.outputint(towerId);
-    io.terminate();
-    io.outputstring("Active Users: ");
-    io.outputint(getCurrentLoad());
-    io.outputstring("/");
-    io.outputint(getTotalCapacity());
-    io.terminate();
+// Report sections shared by CellTower and LazyTower
+template<typename Sink>
+static void displayTowerStatus(Sink& out, unsigned int towerId, unsigned int load,
+                               unsigned int capacity, const CellularCore* core) {
+    out.append("\n--- Tower Status ---");
+    out.newline();
+    out.append("Tower ID: ");
+    out.append(towerId);
+    out.newline();
+    out.append("Active Users: ");
+    out.append(load);
+    out.append("/");
+    out.append(capacity);
+    out.newline();
     
     if (core) {
-        io.outputstring("Cellular Core: ");
-        io.outputstring(core->getProtocolName());
-        io.terminate();
+        out.append("Cellular Core: ");
+        out.append(core->getProtocolName());
+        out.newline();
+    }
+}
+
+template<typename Sink>
+static void displayChannelTotals(Sink& out, unsigned int channelBw, unsigned int totalUsers,
+                                 unsigned int antennas) {
+    out.append("\n--- Users in First Channel (0-");
+    out.append(channelBw);
+    out.append(" kHz) ---");
+    out.newline();
+    
+    out.append("Total Users: ");
+    out.append(totalUsers);
+    
+    if (antennas > 1) {
+        out.append(" across ");
+        out.append(antennas);
+        out.append(" antennas (parallel)");
+    }
+    out.newline();
+}
+
+template<typename Sink>
+static void displayNoChannels(Sink& out) {
+    out.append("\n--- Users in First Channel ---");
+    out.newline();
+    out.append("Channels: None");
+    out.newline();
+}
+
+// One line per antenna of an AntennaView or LazyChannelView
+template<typename View, typename Sink>
+static void displayAntennaGroups(Sink& out, const View& view) {
+    out.newline();
+    for (unsigned int ant = 0; ant < view.getAntennaCount(); ++ant) {
+        out.append("Antenna ");
+        out.append(ant + 1);
+        out.append(": ");
+        
+        const unsigned int count = view.getUserCount(ant);
+        for (unsigned int i = 0; i < count; ++i) {
+            if (i > 0) {
+                out.append(", ");
+            }
+            out.append(view.getDeviceId(ant, i));
+        }
+        
+        if (count == 0) {
+            out.append("None");
+        }
+        out.newline();
     }
 }
 
-void CellTower::displayFirstChannelUsers() const {
-    Channel<UserDevice>* firstChannel = channels[0];
-    unsigned int channelBw = firstChannel->getBandwidth();
+template<typename Sink>
+void CellTower::displayTowerInfo(Sink& out) const {
+    displayTowerStatus(out, towerId, getCurrentLoad(), getTotalCapacity(), core);
+}
+
+template<typename Sink>
+void CellTower::displayFirstChannelUsers(Sink& out, bool listDevices) const {
+    if (channelCount == 0) {
+        displayNoChannels(out);
+        return;
+    }
+    
+    Channel<DevicePool>* firstChannel = channels[0];
     unsigned int totalUsers = firstChannel->getCurrentUsers();
     unsigned int antennas = firstChannel->getAntennaCount();
     
-    io.outputstring("\n--- Users in First Channel (0-");
-    io.outputint(channelBw);
-    io.outputstring(" kHz) ---");
-    io.terminate();
-    
-    io.outputstring("Total Users: ");
-    io.outputint(totalUsers);
+    displayChannelTotals(out, firstChannel->getBandwidth(), totalUsers, antennas);
     
-    if (antennas > 1) {
-        io.outputstring(" across ");
-        io.outputint(antennas);
-        io.outputstring(" antennas (parallel)");
+    if (!listDevices) {
+        return;
     }
-    io.terminate();
     
     if (totalUsers == 0) {
-        io.outputstring("Device IDs: None");
-        io.terminate();
+        out.append("Device IDs: None");
+        out.newline();
         return;
     }
     
+    // Slots are walked in order through the occupancy bitmap
+    unsigned int slotEnd = firstChannel->getMaxUsers();
+    
     if (antennas == 1) {
-        io.outputstring("Device IDs: ");
-        for (unsigned int i = 0; i < totalUsers; ++i) {
-            UserDevice* device = firstChannel->getDevice(i);
-            if (device) {
-                io.outputint(device->getDeviceId());
-                if (i < totalUsers - 1) {
-                    io.outputstring(", ");
-                }
+        out.append("Device IDs: ");
+        unsigned int slot = firstChannel->nextOccupiedSlot(0);
+        while (slot < slotEnd) {
+            out.append(firstChannel->getDeviceId(slot));
+            slot = firstChannel->nextOccupiedSlot(slot + 1);
+            if (slot < slotEnd) {
+                out.append(", ");
             }
         }
-        io.terminate();
+        out.newline();
     } else {
-        io.terminate();
-        for (unsigned int ant = 1; ant <= antennas; ++ant) {
-            io.outputstring("Antenna ");
-            io.outputint(ant);
-            io.outputstring(": ");
-            
-            unsigned int count = 0;
-            for (unsigned int i = 0; i < totalUsers; ++i) {
-                UserDevice* device = firstChannel->getDevice(i);
-                if (device) {
-                    unsigned int deviceId = device->getDeviceId();
-                    unsigned int assignedAntenna = ((deviceId - 1) % antennas) + 1;
-                    
-                    if (assignedAntenna == ant) {
-                        io.outputint(deviceId);
-                        count++;
-                        
-                        bool hasMore = false;
-                        for (unsigned int j = i + 1; j < totalUsers; ++j) {
-                            UserDevice* nextDev = firstChannel->getDevice(j);
-                            if (nextDev) {
-                                unsigned int nextAnt = ((nextDev->getDeviceId() - 1) % antennas) + 1;
-                                if (nextAnt == ant) {
-                                    hasMore = true;
-                                    break;
-                                }
-                            }
-                        }
-                        
-                        if (hasMore) {
-                            io.outputstring(", ");
-                        }
-                    }
-                }
-            }
-            
-            if (count == 0) {
-                io.outputstring("None");
+        displayAntennaGroups(out, AntennaView<DevicePool>(*firstChannel));
+    }
+}
+
+LazyTower::LazyTower(unsigned int id, CellularCore* cellCore, unsigned int bandwidth,
+                     unsigned int channelBw, unsigned int usersPerChannel, unsigned int antennas,
+                     AntennaPolicy policy)
+    : towerId(id), core(cellCore), channelCount(channelsInBand(bandwidth, channelBw)),
+      channelBandwidth(channelBw), usersPerAntenna(usersPerChannel), antennaCount(antennas),
+      currentLoad(0), antennaPolicy(policy) {}
+
+unsigned int LazyTower::admitDevices(unsigned int count) {
+    unsigned int room = getTotalCapacity() - currentLoad;
+    unsigned int admitted = (count < room) ? count : room;
+    currentLoad += admitted;
+    return admitted;
+}
+
+// Channels fill completely, in order
+unsigned int LazyTower::getChannelUsers(unsigned int channel) const {
+    unsigned int perChannel = usersPerAntenna * antennaCount;
+    if (channel >= channelCount || currentLoad <= channel * perChannel) {
+        return 0;
+    }
+    unsigned int users = currentLoad - channel * perChannel;
+    return (users < perChannel) ? users : perChannel;
+}
+
+// Spatial fills one antenna's range after the other; round-robin and
+// least-loaded both deal the channel's devices out one per antenna in turn
+unsigned int LazyTower::getAntennaLoad(unsigned int channel, unsigned int antenna) const {
+    unsigned int users = getChannelUsers(channel);
+    if (antennaPolicy == ANTENNA_SPATIAL) {
+        unsigned int before = antenna * usersPerAntenna;
+        if (users <= before) return 0;
+        return (users - before < usersPerAntenna) ? users - before : usersPerAntenna;
+    }
+    return users / antennaCount + ((antenna < users % antennaCount) ? 1 : 0);
+}
+
+bool LazyTower::findDevice(unsigned int id, LazyDevice& device) const {
+    if (id == 0 || id > currentLoad) {
+        return false;
+    }
+    
+    // Position of the device among its channel's devices, in admission order
+    unsigned int perChannel = usersPerAntenna * antennaCount;
+    unsigned int position = (id - 1) % perChannel;
+    unsigned int antenna;
+    unsigned int i;
+    if (antennaPolicy == ANTENNA_SPATIAL) {
+        antenna = position / usersPerAntenna;
+        i = position % usersPerAntenna;
+    } else {
+        antenna = position % antennaCount;
+        i = position / antennaCount;
+    }
+    
+    device.id = id;
+    device.channel = (id - 1) / perChannel;
+    device.frequency = device.channel * channelBandwidth;
+    device.slot = antenna * usersPerAntenna + i;
+    device.antenna = antenna;
+    return true;
+}
+
+unsigned int LazyChannelView::getAntennaCount() const {
+    return tower->getAntennaCount();
+}
+
+unsigned int LazyChannelView::getUserCount(unsigned int antenna) const {
+    return tower->getAntennaLoad(channel, antenna);
+}
+
+// Each antenna hands out its own slots lowest first
+unsigned int LazyChannelView::getSlot(unsigned int antenna, unsigned int i) const {
+    return antenna * tower->getUsersPerAntenna() + i;
+}
+
+unsigned int LazyChannelView::getDeviceId(unsigned int antenna, unsigned int i) const {
+    unsigned int perChannel = tower->getUsersPerAntenna() * tower->getAntennaCount();
+    unsigned int position = (tower->getAntennaPolicy() == ANTENNA_SPATIAL)
+        ? antenna * tower->getUsersPerAntenna() + i
+        : i * tower->getAntennaCount() + antenna;
+    return channel * perChannel + position + 1;
+}
+
+template<typename Sink>
+void LazyTower::displayTowerInfo(Sink& out) const {
+    displayTowerStatus(out, towerId, currentLoad, getTotalCapacity(), core);
+}
+
+template<typename Sink>
+void LazyTower::displayFirstChannelUsers(Sink& out, bool listDevices) const {
+    if (channelCount == 0) {
+        displayNoChannels(out);
+        return;
+    }
+    
+    unsigned int totalUsers = getChannelUsers(0);
+    
+    displayChannelTotals(out, channelBandwidth, totalUsers, antennaCount);
+    
+    if (!listDevices) {
+        return;
+    }
+    
+    if (totalUsers == 0) {
+        out.append("Device IDs: None");
+        out.newline();
+        return;
+    }
+    
+    // A single antenna holds the IDs 1..totalUsers in slot order
+    if (antennaCount == 1) {
+        out.append("Device IDs: ");
+        for (unsigned int id = 1; id <= totalUsers; ++id) {
+            out.append(id);
+            if (id < totalUsers) {
+                out.append(", ");
             }
-            io.terminate();
         }
+        out.newline();
+    } else {
+        displayAntennaGroups(out, getChannelView(0));
     }
-}
\ No newline at end of file
+}
+
+template void CellTower::displayTowerInfo<DirectSink>(DirectSink&) const;
+template void CellTower::displayTowerInfo<CharBuffer>(CharBuffer&) const;
+template void CellTower::displayTowerInfo<NullSink>(NullSink&) const;
+template void CellTower::displayFirstChannelUsers<DirectSink>(DirectSink&, bool) const;
+template void CellTower::displayFirstChannelUsers<CharBuffer>(CharBuffer&, bool) const;
+template void CellTower::displayFirstChannelUsers<NullSink>(NullSink&, bool) const;
+template void LazyTower::displayTowerInfo<DirectSink>(DirectSink&) const;
+template void LazyTower::displayTowerInfo<CharBuffer>(CharBuffer&) const;
+template void LazyTower::displayTowerInfo<NullSink>(NullSink&) const;
+template void LazyTower::displayFirstChannelUsers<DirectSink>(DirectSink&, bool) const;
+template void LazyTower::displayFirstChannelUsers<CharBuffer>(CharBuffer&, bool) const;
+template void LazyTower::displayFirstChannelUsers<NullSink>(NullSink&, bool) const;
@@ -2,41 +2,211 @@
 #ifndef CELLTOWER_H
 #define CELLTOWER_H
 
-#include "UserDevice.h"
+#include "DevicePool.h"
 #include "CellularCore.h"
 
+class ThreadPool;
+
+// How a channel picks the antenna (beam) for a new device
+enum AntennaPolicy {
+    ANTENNA_ROUND_ROBIN,    // Next antenna in turn that has room
+    ANTENNA_LEAST_LOADED,   // Antenna serving the fewest devices (ties: lowest)
+    ANTENNA_SPATIAL         // Runs of consecutive device IDs share a beam;
+                            // least loaded once the preferred beam is full
+};
+
+// How a single-tower simulation holds its devices
+enum DevicePlacement {
+    PLACEMENT_MATERIALIZED, // Device pool, channels and bitmaps (CellTower)
+    PLACEMENT_LAZY          // Derived from the load when queried (LazyTower)
+};
+
+// Channels of channelBandwidth that fit in the band; a zero channel
+// bandwidth gives none, as in the capacity analysis
+inline unsigned int channelsInBand(unsigned int bandwidth, unsigned int channelBandwidth) {
+    return (channelBandwidth > 0) ? bandwidth / channelBandwidth : 0;
+}
+
+// T is the device store the channel's indices refer to. Every antenna owns
+// its own range of slots, antenna a the slots a * usersPerAntenna onwards,
+// so the antenna serving a device is stored by where it sits. Slots are
+// stable: a released slot keeps its position and is handed out again by
+// the next assignment to that antenna, lowest free slot first, found
+// through the antenna's part of the occupancy bitmap.
 template<typename T>
 class Channel {
 private:
     unsigned int channelId;
     unsigned int frequencyStart;
     unsigned int bandwidth;
-    T** assignedDevices;
+    const T* devices;
+    unsigned int* assignedDevices;
     unsigned int maxUsers;
     unsigned int currentUsers;
     unsigned int antennaCount;
+    unsigned int usersPerAntenna;
+    AntennaPolicy policy;
+    unsigned int nextAntenna;           // Round-robin position
+    
+    // Per antenna: devices served and the first bitmap word with a free slot
+    struct AntennaState {
+        unsigned int load;
+        unsigned int firstFree;
+    };
+    AntennaState* antennaState;
+    
+    // One bit per occupied slot, wordsPerAntenna words per antenna; bits
+    // past usersPerAntenna are kept set so the search for a free slot never
+    // lands outside the antenna's range
+    unsigned long long* occupied;
+    unsigned int wordsPerAntenna;
+    
+    unsigned int bitWord(unsigned int slot) const {
+        return (slot / usersPerAntenna) * wordsPerAntenna + (slot % usersPerAntenna) / 64;
+    }
+    
+    unsigned long long bitMask(unsigned int slot) const {
+        return 1ULL << ((slot % usersPerAntenna) % 64);
+    }
+    
+    unsigned int leastLoadedAntenna() const {
+        unsigned int best = 0;
+        for (unsigned int a = 1; a < antennaCount; ++a) {
+            if (antennaState[a].load < antennaState[best].load) best = a;
+        }
+        return best;
+    }
+    
+    // Only called while the channel has room, so some antenna has too
+    unsigned int pickAntenna(unsigned int deviceIndex) {
+        switch (policy) {
+            case ANTENNA_LEAST_LOADED:
+                return leastLoadedAntenna();
+            case ANTENNA_SPATIAL: {
+                unsigned int preferred = ((devices->getDeviceId(deviceIndex) - 1) / usersPerAntenna) % antennaCount;
+                return (antennaState[preferred].load < usersPerAntenna) ? preferred : leastLoadedAntenna();
+            }
+            default: {
+                unsigned int chosen = nextAntenna;
+                while (antennaState[chosen].load == usersPerAntenna) {
+                    chosen = (chosen + 1 == antennaCount) ? 0 : chosen + 1;
+                }
+                nextAntenna = (chosen + 1 == antennaCount) ? 0 : chosen + 1;
+                return chosen;
+            }
+        }
+    }
     
 public:
-    Channel(unsigned int id, unsigned int freqStart, unsigned int bw, 
-            unsigned int maxUsr, unsigned int antennas = 1) 
-        : channelId(id), frequencyStart(freqStart), bandwidth(bw), 
-          maxUsers(maxUsr * antennas), currentUsers(0), antennaCount(antennas) {
-        assignedDevices = new T*[maxUsers];
+    Channel(unsigned int id, const T* deviceStore, unsigned int freqStart, unsigned int bw, 
+            unsigned int maxUsr, unsigned int antennas = 1,
+            AntennaPolicy antennaPolicy = ANTENNA_ROUND_ROBIN) 
+        : channelId(id), frequencyStart(freqStart), bandwidth(bw), devices(deviceStore),
+          currentUsers(0), antennaCount(antennas),
+          usersPerAntenna(maxUsr), policy(antennaPolicy), nextAntenna(0),
+          wordsPerAntenna((maxUsr + 63) / 64) {
+        maxUsers = usersPerAntenna * antennaCount;
+        assignedDevices = new unsigned int[maxUsers];
         for (unsigned int i = 0; i < maxUsers; ++i) {
-            assignedDevices[i] = nullptr;
+            assignedDevices[i] = NO_DEVICE;
+        }
+        
+        antennaState = new AntennaState[antennaCount];
+        for (unsigned int a = 0; a < antennaCount; ++a) {
+            antennaState[a].load = 0;
+            antennaState[a].firstFree = 0;
+        }
+        
+        const unsigned int words = wordsPerAntenna * antennaCount;
+        occupied = new unsigned long long[words > 0 ? words : 1];
+        for (unsigned int w = 0; w < words; ++w) {
+            occupied[w] = 0;
+        }
+        if (usersPerAntenna % 64 != 0) {
+            for (unsigned int a = 0; a < antennaCount; ++a) {
+                occupied[(a + 1) * wordsPerAntenna - 1] = ~0ULL << (usersPerAntenna % 64);
+            }
         }
     }
     
     ~Channel() {
         delete[] assignedDevices;
+        delete[] antennaState;
+        delete[] occupied;
+    }
+    
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+    
+    // Returns the slot the device was placed in, or NO_DEVICE when full
+    unsigned int assignDevice(unsigned int deviceIndex) {
+        if (currentUsers == maxUsers) {
+            return NO_DEVICE;
+        }
+        
+        const unsigned int antenna = pickAntenna(deviceIndex);
+        AntennaState& state = antennaState[antenna];
+        unsigned long long* words = occupied + antenna * wordsPerAntenna;
+        while (words[state.firstFree] == ~0ULL) {
+            state.firstFree++;
+        }
+        unsigned int bit = __builtin_ctzll(~words[state.firstFree]);
+        words[state.firstFree] |= 1ULL << bit;
+        
+        unsigned int slot = antenna * usersPerAntenna + state.firstFree * 64 + bit;
+        assignedDevices[slot] = deviceIndex;
+        state.load++;
+        currentUsers++;
+        return slot;
+    }
+    
+    // O(1): clears the slot and lowers its antenna's free-slot hint
+    bool releaseSlot(unsigned int slot) {
+        if (!isOccupied(slot)) {
+            return false;
+        }
+        
+        occupied[bitWord(slot)] &= ~bitMask(slot);
+        assignedDevices[slot] = NO_DEVICE;
+        currentUsers--;
+        
+        AntennaState& state = antennaState[slot / usersPerAntenna];
+        state.load--;
+        const unsigned int word = (slot % usersPerAntenna) / 64;
+        if (word < state.firstFree) {
+            state.firstFree = word;
+        }
+        return true;
     }
     
-    bool assignDevice(T* device) {
-        if (currentUsers < maxUsers) {
-            assignedDevices[currentUsers++] = device;
-            return true;
+    bool isOccupied(unsigned int slot) const {
+        return slot < maxUsers && (occupied[bitWord(slot)] & bitMask(slot));
+    }
+    
+    // First occupied slot at or after slot, or getMaxUsers() if none. Slot
+    // order is antenna order.
+    unsigned int nextOccupiedSlot(unsigned int slot) const {
+        while (slot < maxUsers) {
+            const unsigned int antenna = slot / usersPerAntenna;
+            const unsigned int offset = slot % usersPerAntenna;
+            const unsigned long long* words = occupied + antenna * wordsPerAntenna;
+            
+            unsigned int word = offset / 64;
+            unsigned long long bits = words[word] & (~0ULL << (offset % 64));
+            while (true) {
+                if (bits != 0) {
+                    unsigned int found = word * 64 + __builtin_ctzll(bits);
+                    if (found < usersPerAntenna) {
+                        return antenna * usersPerAntenna + found;
+                    }
+                    break;
+                }
+                if (++word == wordsPerAntenna) break;
+                bits = words[word];
+            }
+            slot = (antenna + 1) * usersPerAntenna;
         }
-        return false;
+        return maxUsers;
     }
     
     unsigned int getChannelId() const { return channelId; }
@@ -45,51 +215,207 @@ public:
     unsigned int getCurrentUsers() const { return currentUsers; }
     unsigned int getMaxUsers() const { return maxUsers; }
     unsigned int getAntennaCount() const { return antennaCount; }
-    unsigned int getUsersPerAntenna() const { 
-        return (antennaCount > 0) ? (maxUsers / antennaCount) : maxUsers; 
+    unsigned int getUsersPerAntenna() const { return usersPerAntenna; }
+    AntennaPolicy getAntennaPolicy() const { return policy; }
+    
+    // Devices served by the antenna (0-based), O(1)
+    unsigned int getAntennaLoad(unsigned int antenna) const { return antennaState[antenna].load; }
+    
+    // Antenna (0-based) a slot belongs to
+    unsigned int getAntenna(unsigned int slot) const { return slot / usersPerAntenna; }
+    
+    // Device in the slot, or NO_DEVICE for a free slot
+    unsigned int getDevice(unsigned int slot) const {
+        if (slot < maxUsers) return assignedDevices[slot];
+        return NO_DEVICE;
     }
     
-    T* getDevice(unsigned int index) const {
-        if (index < currentUsers) return assignedDevices[index];
-        return nullptr;
+    unsigned int getDeviceId(unsigned int slot) const {
+        return devices->getDeviceId(assignedDevices[slot]);
     }
     
     void displayChannelInfo() const;
 };
 
+// The occupied slots of a channel grouped by antenna, in slot order within
+// each antenna. Antennas own consecutive slot ranges, so one walk over the
+// occupancy bitmap, O(users + bitmap words), fills every group; the report,
+// the result records and any per-antenna analysis read the same view.
+template<typename T>
+class AntennaView {
+private:
+    const Channel<T>* channel;
+    unsigned int antennaCount;
+    unsigned int* start;        // Antenna a owns slots[start[a] .. start[a + 1])
+    unsigned int* slots;
+    
+public:
+    explicit AntennaView(const Channel<T>& source)
+        : channel(&source), antennaCount(source.getAntennaCount()) {
+        start = new unsigned int[antennaCount + 1];
+        slots = new unsigned int[source.getCurrentUsers() > 0 ? source.getCurrentUsers() : 1];
+        
+        start[0] = 0;
+        for (unsigned int a = 0; a < antennaCount; ++a) {
+            start[a + 1] = start[a] + source.getAntennaLoad(a);
+        }
+        
+        unsigned int count = 0;
+        const unsigned int slotEnd = source.getMaxUsers();
+        for (unsigned int s = source.nextOccupiedSlot(0); s < slotEnd; s = source.nextOccupiedSlot(s + 1)) {
+            slots[count++] = s;
+        }
+    }
+    
+    ~AntennaView() {
+        delete[] start;
+        delete[] slots;
+    }
+    
+    AntennaView(const AntennaView&) = delete;
+    AntennaView& operator=(const AntennaView&) = delete;
+    
+    unsigned int getAntennaCount() const { return antennaCount; }
+    unsigned int getUserCount(unsigned int antenna) const { return start[antenna + 1] - start[antenna]; }
+    
+    // i-th device (in slot order) on the antenna
+    unsigned int getSlot(unsigned int antenna, unsigned int i) const { return slots[start[antenna] + i]; }
+    unsigned int getDeviceId(unsigned int antenna, unsigned int i) const {
+        return channel->getDeviceId(getSlot(antenna, i));
+    }
+};
+
 class CellTower {
 private:
     unsigned int towerId;
     CellularCore* core;
-    Channel<UserDevice>** channels;
+    DevicePool* devices;
+    Channel<DevicePool>** channels;
     unsigned int channelCount;
     unsigned int totalBandwidth;
     unsigned int maxUsersPerChannel;
     unsigned int antennaCount;
+    unsigned int currentLoad;
+    AntennaPolicy antennaPolicy;
+    
+    // One bit per channel that still has a free slot, so first-fit admission
+    // is a ctz over the first non-zero word instead of a scan of all channels
+    unsigned long long* openChannels;
+    unsigned int openWordCount;
+    unsigned int firstOpenWord;
     
     void setupChannels(unsigned int bandwidth, unsigned int usersPerChannel, unsigned int antennas);
+    int findFirstOpenChannel();
+    void fillChannels(unsigned int firstChannel, unsigned int lastChannel,
+                      unsigned int firstDevice, unsigned int deviceCount);
+    void refreshOpenChannels();
     
 public:
-    CellTower(unsigned int id, CellularCore* cellCore,
+    CellTower(unsigned int id, CellularCore* cellCore, DevicePool* devicePool,
               unsigned int bandwidth, unsigned int channelBandwidth, 
-              unsigned int usersPerChannel, unsigned int antennas = 1);
+              unsigned int usersPerChannel, unsigned int antennas = 1,
+              AntennaPolicy policy = ANTENNA_ROUND_ROBIN);
     ~CellTower();
     
     CellTower(const CellTower&) = delete;
     CellTower& operator=(const CellTower&) = delete;
     
-    bool assignDeviceToChannel(UserDevice* device, unsigned int channelIndex);
-    bool assignDeviceToFirstAvailable(UserDevice* device);
+    bool assignDeviceToChannel(unsigned int deviceIndex, unsigned int channelIndex);
+    bool assignDeviceToFirstAvailable(unsigned int deviceIndex);
+    bool releaseDevice(unsigned int deviceIndex);
+    unsigned int admitDevices(unsigned int firstDevice, unsigned int count, ThreadPool* pool = nullptr);
     
     unsigned int getTowerId() const { return towerId; }
     unsigned int getChannelCount() const { return channelCount; }
     unsigned int getTotalCapacity() const;
-    unsigned int getCurrentLoad() const;
+    unsigned int getCurrentLoad() const { return currentLoad; }
     unsigned int getAntennaCount() const { return antennaCount; }
-    Channel<UserDevice>* getChannel(unsigned int index) const;
+    AntennaPolicy getAntennaPolicy() const { return antennaPolicy; }
+    DevicePool* getDevicePool() const { return devices; }
+    Channel<DevicePool>* getChannel(unsigned int index) const;
+    
+    template<typename Sink>
+    void displayTowerInfo(Sink& out) const;
+    // listDevices false stops after the user totals
+    template<typename Sink>
+    void displayFirstChannelUsers(Sink& out, bool listDevices = true) const;
+};
+
+class LazyTower;
+
+// The devices of one channel of a LazyTower grouped by antenna, with the
+// interface of AntennaView; every query is arithmetic
+class LazyChannelView {
+private:
+    const LazyTower* tower;
+    unsigned int channel;
+    
+public:
+    LazyChannelView(const LazyTower& source, unsigned int channelIndex)
+        : tower(&source), channel(channelIndex) {}
+    
+    unsigned int getAntennaCount() const;
+    unsigned int getUserCount(unsigned int antenna) const;
+    unsigned int getSlot(unsigned int antenna, unsigned int i) const;
+    unsigned int getDeviceId(unsigned int antenna, unsigned int i) const;
+};
+
+// Where one device of a LazyTower sits, worked out when it is asked for
+struct LazyDevice {
+    unsigned int id;
+    unsigned int channel;
+    unsigned int frequency;
+    unsigned int slot;
+    unsigned int antenna;
+};
+
+// A tower admitting devices 1, 2, 3... first-fit from empty, the way a
+// capacity run fills a CellTower. That fill has a closed form: channel c
+// holds the next usersPerChannel * antennas IDs, and each antenna policy
+// spreads a channel's consecutive IDs over its antennas in a fixed
+// pattern. So no channel, bitmap or device pool is kept; occupancy, the
+// device-to-channel mapping and the report are derived from the load on
+// demand, and a device is only materialized when it is queried. Reports
+// match those of a CellTower filled with the same devices.
+class LazyTower {
+private:
+    unsigned int towerId;
+    CellularCore* core;
+    unsigned int channelCount;
+    unsigned int channelBandwidth;
+    unsigned int usersPerAntenna;
+    unsigned int antennaCount;
+    unsigned int currentLoad;
+    AntennaPolicy antennaPolicy;
+    
+public:
+    LazyTower(unsigned int id, CellularCore* cellCore, unsigned int bandwidth,
+              unsigned int channelBw, unsigned int usersPerChannel, unsigned int antennas = 1,
+              AntennaPolicy policy = ANTENNA_ROUND_ROBIN);
+    
+    // Admits the next count device IDs and returns how many fit, O(1)
+    unsigned int admitDevices(unsigned int count);
+    
+    unsigned int getTowerId() const { return towerId; }
+    unsigned int getChannelCount() const { return channelCount; }
+    unsigned int getTotalCapacity() const { return channelCount * usersPerAntenna * antennaCount; }
+    unsigned int getCurrentLoad() const { return currentLoad; }
+    unsigned int getAntennaCount() const { return antennaCount; }
+    unsigned int getUsersPerAntenna() const { return usersPerAntenna; }
+    AntennaPolicy getAntennaPolicy() const { return antennaPolicy; }
+    unsigned int getChannelBandwidth() const { return channelBandwidth; }
+    
+    unsigned int getChannelUsers(unsigned int channel) const;
+    unsigned int getAntennaLoad(unsigned int channel, unsigned int antenna) const;
+    LazyChannelView getChannelView(unsigned int channel) const { return LazyChannelView(*this, channel); }
+    
+    // Fills device for an admitted ID (1-based); false if it is not on the tower
+    bool findDevice(unsigned int id, LazyDevice& device) const;
     
-    void displayTowerInfo() const;
-    void displayFirstChannelUsers() const;
+    template<typename Sink>
+    void displayTowerInfo(Sink& out) const;
+    template<typename Sink>
+    void displayFirstChannelUsers(Sink& out, bool listDevices = true) const;
 };
 
 #endif
\ No newline at end of file
@@ -8,9 +8,9 @@ void Core2G::displayCoreInfo() const {
     io.outputstring(", Capacity: ");
     io.outputint(capacity);
     io.outputstring(", Load: ");
-    io.outputint(currentLoad);
+    io.outputint(getCurrentLoad());
     io.outputstring(", Overhead: ");
-    io.outputint((unsigned int)calculateOverhead());
+    io.outputint(OVERHEAD_PERCENT);
     io.outputstring("%");
     io.terminate();
 }
@@ -21,9 +21,9 @@ void Core3G::displayCoreInfo() const {
     io.outputstring(", Capacity: ");
     io.outputint(capacity);
     io.outputstring(", Load: ");
-    io.outputint(currentLoad);
+    io.outputint(getCurrentLoad());
     io.outputstring(", Overhead: ");
-    io.outputint((unsigned int)calculateOverhead());
+    io.outputint(OVERHEAD_PERCENT);
     io.outputstring("%");
     io.terminate();
 }
@@ -36,9 +36,9 @@ void Core4G::displayCoreInfo() const {
     io.outputstring(", MIMO: ");
     io.outputint(mimoAntennas);
     io.outputstring(", Load: ");
-    io.outputint(currentLoad);
+    io.outputint(getCurrentLoad());
     io.outputstring(", Overhead: ");
-    io.outputint((unsigned int)calculateOverhead());
+    io.outputint(OVERHEAD_PERCENT);
     io.outputstring("%");
     io.terminate();
 }
@@ -51,9 +51,9 @@ void Core5G::displayCoreInfo() const {
     io.outputstring(", Massive MIMO: ");
     io.outputint(massiveMimoAntennas);
     io.outputstring(", Load: ");
-    io.outputint(currentLoad);
+    io.outputint(getCurrentLoad());
     io.outputstring(", Overhead: ");
-    io.outputint((unsigned int)calculateOverhead());
+    io.outputint(OVERHEAD_PERCENT);
     io.outputstring("%");
     io.terminate();
 }
\ No newline at end of file
@@ -2,104 +2,163 @@
 #ifndef CELLULARCORE_H
 #define CELLULARCORE_H
 
+#include <atomic>
+
+#define CACHE_LINE_SIZE 64
+
+// Load and contention counters of one core, alone on their cache line so
+// cores updated from different threads never invalidate each other
+struct alignas(CACHE_LINE_SIZE) CoreLoadCounter {
+    std::atomic<unsigned int> load;
+    std::atomic<unsigned int> retries;      // Lost compare-and-swap rounds
+    
+    CoreLoadCounter() : load(0), retries(0) {}
+};
+
+// Load accounting is lock-free: towers on different threads may reserve
+// capacity on the same core concurrently.
 class CellularCore {
 protected:
     unsigned int coreId;
     unsigned int capacity;
-    unsigned int currentLoad;
+    CoreLoadCounter counter;
     
 public:
     CellularCore(unsigned int id, unsigned int cap) 
-        : coreId(id), capacity(cap), currentLoad(0) {}
+        : coreId(id), capacity(cap) {}
     
     virtual ~CellularCore() {}
     
+    CellularCore(const CellularCore&) = delete;
+    CellularCore& operator=(const CellularCore&) = delete;
+    
+    // Display only; the per-generation constants behind them are in
+    // CORE_TRAITS and CoreModel
     virtual double calculateOverhead() const = 0;
     virtual const char* getProtocolName() const = 0;
     virtual void displayCoreInfo() const = 0;
     
     unsigned int getCoreId() const { return coreId; }
     unsigned int getCapacity() const { return capacity; }
-    unsigned int getCurrentLoad() const { return currentLoad; }
+    unsigned int getCurrentLoad() const { return counter.load.load(std::memory_order_relaxed); }
+    unsigned int getContention() const { return counter.retries.load(std::memory_order_relaxed); }
     
+    // All or nothing
     bool addLoad(unsigned int load) {
-        if (currentLoad + load <= capacity) {
-            currentLoad += load;
-            return true;
+        unsigned int current = counter.load.load(std::memory_order_relaxed);
+        while (load <= capacity && current <= capacity - load) {
+            if (counter.load.compare_exchange_weak(current, current + load,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                return true;
+            }
+            counter.retries.fetch_add(1, std::memory_order_relaxed);
         }
         return false;
     }
     
-    void resetLoad() { currentLoad = 0; }
+    // Takes as much of load as still fits and returns the amount reserved
+    unsigned int reserveLoad(unsigned int load) {
+        unsigned int current = counter.load.load(std::memory_order_relaxed);
+        while (current < capacity) {
+            unsigned int take = (load < capacity - current) ? load : capacity - current;
+            if (take == 0) return 0;
+            if (counter.load.compare_exchange_weak(current, current + take,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                return take;
+            }
+            counter.retries.fetch_add(1, std::memory_order_relaxed);
+        }
+        return 0;
+    }
+    
+    void releaseLoad(unsigned int load) {
+        unsigned int current = counter.load.load(std::memory_order_relaxed);
+        unsigned int next = (load < current) ? current - load : 0;
+        while (!counter.load.compare_exchange_weak(current, next,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+            counter.retries.fetch_add(1, std::memory_order_relaxed);
+            next = (load < current) ? current - load : 0;
+        }
+    }
+    
+    void resetLoad() { counter.load.store(0, std::memory_order_relaxed); }
+};
+
+// Fixed properties of each generation's core, indexed by generation - 2
+struct CoreTraits {
+    unsigned int overheadPercent;   // Nominal protocol overhead
+    const char* protocolName;
+};
+
+static constexpr CoreTraits CORE_TRAITS[4] = {
+    {8, "2G (TDMA - Circuit/Packet Switching)"},
+    {5, "3G (CDMA - Packet Switching)"},
+    {3, "4G (OFDM with MIMO - All IP Packet)"},
+    {2, "5G (Massive MIMO - High Frequency)"}
 };
 
-class Core2G : public CellularCore {
+// Base of the concrete cores. The generation is a template argument, so
+// its constants are known at compile time: code holding a concrete core
+// type (or just the generation) reads them without an indirect call, and
+// the virtual interface remains for code that only has a CellularCore*.
+template<unsigned int Generation>
+class CoreModel : public CellularCore {
+    static_assert(Generation >= 2 && Generation <= 5, "Unknown core generation");
+    
 public:
-    Core2G(unsigned int id, unsigned int cap) : CellularCore(id, cap) {}
+    static constexpr unsigned int GENERATION = Generation;
+    static constexpr unsigned int OVERHEAD_PERCENT = CORE_TRAITS[Generation - 2].overheadPercent;
+    static constexpr const char* PROTOCOL_NAME = CORE_TRAITS[Generation - 2].protocolName;
     
-    double calculateOverhead() const override {
-        return 8.0;
+    CoreModel(unsigned int id, unsigned int cap) : CellularCore(id, cap) {}
+    
+    double calculateOverhead() const final {
+        return OVERHEAD_PERCENT;
     }
     
-    const char* getProtocolName() const override {
-        return "2G (TDMA - Circuit/Packet Switching)";
+    const char* getProtocolName() const final {
+        return PROTOCOL_NAME;
     }
+};
+
+class Core2G final : public CoreModel<2> {
+public:
+    Core2G(unsigned int id, unsigned int cap) : CoreModel(id, cap) {}
     
     void displayCoreInfo() const override;
 };
 
-class Core3G : public CellularCore {
+class Core3G final : public CoreModel<3> {
 public:
-    Core3G(unsigned int id, unsigned int cap) : CellularCore(id, cap) {}
-    
-    double calculateOverhead() const override {
-        return 5.0;
-    }
-    
-    const char* getProtocolName() const override {
-        return "3G (CDMA - Packet Switching)";
-    }
+    Core3G(unsigned int id, unsigned int cap) : CoreModel(id, cap) {}
     
     void displayCoreInfo() const override;
 };
 
-class Core4G : public CellularCore {
+class Core4G final : public CoreModel<4> {
 private:
     unsigned int mimoAntennas;
     
 public:
     Core4G(unsigned int id, unsigned int cap, unsigned int antennas = 4) 
-        : CellularCore(id, cap), mimoAntennas(antennas) {}
-    
-    double calculateOverhead() const override {
-        return 3.0;
-    }
-    
-    const char* getProtocolName() const override {
-        return "4G (OFDM with MIMO - All IP Packet)";
-    }
+        : CoreModel(id, cap), mimoAntennas(antennas) {}
     
     unsigned int getMimoAntennas() const { return mimoAntennas; }
     
     void displayCoreInfo() const override;
 };
 
-class Core5G : public CellularCore {
+class Core5G final : public CoreModel<5> {
 private:
     unsigned int massiveMimoAntennas;
     bool millimeterWave;
     
 public:
     Core5G(unsigned int id, unsigned int cap, unsigned int antennas = 16, bool mmWave = true) 
-        : CellularCore(id, cap), massiveMimoAntennas(antennas), millimeterWave(mmWave) {}
-    
-    double calculateOverhead() const override {
-        return 2.0;
-    }
-    
-    const char* getProtocolName() const override {
-        return "5G (Massive MIMO - High Frequency)";
-    }
+        : CoreModel(id, cap), massiveMimoAntennas(antennas), millimeterWave(mmWave) {}
     
     unsigned int getMassiveMimoAntennas() const { return massiveMimoAntennas; }
     bool isMillimeterWave() const { return millimeterWave; }
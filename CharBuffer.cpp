@@ -0,0 +1,135 @@
+// CharBuffer.cpp
+#include "CharBuffer.h"
+#include "StringUtils.h"
+#include "Instrumentation.h"
+
+extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
+
+#define SYS_WRITEV 20
+#define EINTR 4
+#define WRITEV_BATCH 64
+
+struct IoVec {
+    const void* base;
+    unsigned long length;
+};
+
+CharBuffer::CharBuffer() : head(nullptr), tail(nullptr), totalLength(0), chunkCount(0) {}
+
+CharBuffer::~CharBuffer() {
+    clear();
+}
+
+void CharBuffer::addChunk() {
+    Chunk* chunk = new Chunk;
+    chunk->next = nullptr;
+    chunk->used = 0;
+    
+    if (tail) {
+        tail->next = chunk;
+    } else {
+        head = chunk;
+    }
+    tail = chunk;
+    chunkCount++;
+}
+
+void CharBuffer::clear() {
+    while (head) {
+        Chunk* next = head->next;
+        delete head;
+        head = next;
+    }
+    tail = nullptr;
+    totalLength = 0;
+    chunkCount = 0;
+}
+
+void CharBuffer::append(const char* data, unsigned int len) {
+    totalLength += len;
+    
+    while (len > 0) {
+        if (!tail || tail->used == CHARBUFFER_CHUNK_SIZE) {
+            addChunk();
+        }
+        
+        unsigned int room = CHARBUFFER_CHUNK_SIZE - tail->used;
+        unsigned int part = (len < room) ? len : room;
+        char* dest = tail->data + tail->used;
+        for (unsigned int i = 0; i < part; ++i) {
+            dest[i] = data[i];
+        }
+        
+        tail->used += part;
+        data += part;
+        len -= part;
+    }
+}
+
+void CharBuffer::append(const char* str) {
+    append(str, my_strlen(str));
+}
+
+void CharBuffer::append(unsigned int num) {
+    char digits[12];
+    unsigned int len = my_utoa(num, digits);
+    append(digits, len);
+}
+
+void CharBuffer::append(int num) {
+    if (num >= 0) {
+        append((unsigned int)num);
+        return;
+    }
+    
+    char digits[12];
+    digits[0] = '-';
+    unsigned int len = my_utoa(0u - (unsigned int)num, digits + 1);
+    append(digits, len + 1);
+}
+
+void CharBuffer::newline() {
+    append("\n", 1);
+}
+
+// Writes every chunk to fd, up to WRITEV_BATCH chunks per syscall
+bool CharBuffer::writeTo(int fd) const {
+    SIM_TIME_PHASE(PHASE_OUTPUT);
+    const Chunk* chunk = head;
+    unsigned int offset = 0;
+    
+    while (chunk) {
+        IoVec iov[WRITEV_BATCH];
+        int count = 0;
+        
+        const Chunk* cursor = chunk;
+        unsigned int cursorOffset = offset;
+        while (cursor && count < WRITEV_BATCH) {
+            if (cursor->used > cursorOffset) {
+                iov[count].base = cursor->data + cursorOffset;
+                iov[count].length = cursor->used - cursorOffset;
+                count++;
+            }
+            cursor = cursor->next;
+            cursorOffset = 0;
+        }
+        if (count == 0) break;
+        
+        long written = syscall3(SYS_WRITEV, fd, (long)iov, count);
+        SIM_COUNT(COUNTER_SYSCALLS, 1);
+        if (written == -EINTR) continue;
+        if (written <= 0) return false;
+        SIM_COUNT(COUNTER_BYTES_WRITTEN, written);
+        
+        // Skip past whatever the kernel accepted
+        unsigned long remaining = (unsigned long)written;
+        while (chunk && remaining >= chunk->used - offset) {
+            remaining -= chunk->used - offset;
+            chunk = chunk->next;
+            offset = 0;
+        }
+        offset += (unsigned int)remaining;
+    }
+    
+    return true;
+}
@@ -0,0 +1,46 @@
+// CharBuffer.h
+#ifndef CHARBUFFER_H
+#define CHARBUFFER_H
+
+#define CHARBUFFER_CHUNK_SIZE 65536
+
+// Growable output buffer made of a linked list of fixed-size chunks.
+// Appending never moves or truncates existing data, and the chunks can be
+// handed to writev as they are.
+class CharBuffer {
+private:
+    struct Chunk {
+        Chunk* next;
+        unsigned int used;
+        char data[CHARBUFFER_CHUNK_SIZE];
+    };
+    
+    Chunk* head;
+    Chunk* tail;
+    unsigned long totalLength;
+    unsigned int chunkCount;
+    
+    void addChunk();
+    
+public:
+    CharBuffer();
+    ~CharBuffer();
+    
+    CharBuffer(const CharBuffer&) = delete;
+    CharBuffer& operator=(const CharBuffer&) = delete;
+    
+    void append(const char* str);
+    void append(const char* data, unsigned int len);
+    void append(int num);
+    void append(unsigned int num);
+    void newline();
+    void clear();
+    
+    unsigned long size() const { return totalLength; }
+    bool isEmpty() const { return totalLength == 0; }
+    unsigned int getChunkCount() const { return chunkCount; }
+    
+    bool writeTo(int fd) const;
+};
+
+#endif
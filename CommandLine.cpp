@@ -0,0 +1,313 @@
+// CommandLine.cpp
+#include "CommandLine.h"
+#include "StringUtils.h"
+#include "basicIO.h"
+
+// One bit per option that only some modes read; --run, --threads and
+// --help apply to every mode
+#define OPT_ITERATIONS      (1u << 0)
+#define OPT_OUTPUT          (1u << 1)
+#define OPT_VERBOSITY       (1u << 2)
+#define OPT_CORES           (1u << 3)
+#define OPT_CORE_POLICY     (1u << 4)
+#define OPT_ANTENNA_POLICY  (1u << 5)
+#define OPT_PLACEMENT       (1u << 6)
+#define OPT_KERNEL          (1u << 7)
+#define OPT_RESULTS         (1u << 8)
+#define OPT_TOWERS          (1u << 9)
+#define OPT_DYNAMIC         (1u << 10)
+
+// What each batch mode reads; anything else given with it is an error
+// rather than silently ignored
+#define SINGLE_OPTIONS  (OPT_ITERATIONS | OPT_OUTPUT | OPT_VERBOSITY | OPT_CORE_POLICY | \
+                         OPT_ANTENNA_POLICY | OPT_PLACEMENT | OPT_RESULTS)
+#define NETWORK_OPTIONS (OPT_ITERATIONS | OPT_OUTPUT | OPT_CORES | OPT_CORE_POLICY | OPT_TOWERS)
+#define DYNAMIC_OPTIONS (OPT_ITERATIONS | OPT_OUTPUT | OPT_DYNAMIC)
+#define SWEEP_OPTIONS   (OPT_KERNEL | OPT_RESULTS)
+
+unsigned int CommandLine::parseGenerations(const char* list) {
+    if (my_strcmp(list, "all") == 0) {
+        return RUN_ALL;
+    }
+    
+    unsigned int mask = 0;
+    const char* p = list;
+    while (*p) {
+        if ((p[0] < '2' || p[0] > '5') || (p[1] != 'G' && p[1] != 'g')) {
+            throw "Invalid generation list (expected e.g. 2G,4G or all)";
+        }
+        mask |= 1u << (p[0] - '2');
+        p += 2;
+        
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            throw "Invalid generation list (expected e.g. 2G,4G or all)";
+        }
+    }
+    
+    if (mask == 0) {
+        throw "Empty generation list";
+    }
+    return mask;
+}
+
+unsigned int CommandLine::parseCount(const char* text) {
+    if (*text == '\0') {
+        throw "Expected a positive number";
+    }
+    
+    unsigned long value = 0;
+    for (const char* p = text; *p; ++p) {
+        if (*p < '0' || *p > '9') {
+            throw "Expected a positive number";
+        }
+        value = value * 10 + (*p - '0');
+        if (value > 0xFFFFFFFFul) {
+            throw "Number out of range";
+        }
+    }
+    
+    if (value == 0) {
+        throw "Expected a positive number";
+    }
+    return (unsigned int)value;
+}
+
+OutputMode CommandLine::parseOutputMode(const char* text) {
+    if (my_strcmp(text, "direct") == 0) return OUTPUT_DIRECT;
+    if (my_strcmp(text, "buffered") == 0) return OUTPUT_BUFFERED;
+    if (my_strcmp(text, "null") == 0) return OUTPUT_NULL;
+    throw "Invalid output mode (expected direct, buffered or null)";
+}
+
+CorePolicy CommandLine::parseCorePolicy(const char* text) {
+    if (my_strcmp(text, "least-loaded") == 0) return CORE_LEAST_LOADED;
+    if (my_strcmp(text, "p2c") == 0) return CORE_POWER_OF_TWO;
+    if (my_strcmp(text, "hash") == 0) return CORE_CONSISTENT_HASH;
+    throw "Invalid core policy (expected least-loaded, p2c or hash)";
+}
+
+AntennaPolicy CommandLine::parseAntennaPolicy(const char* text) {
+    if (my_strcmp(text, "round-robin") == 0) return ANTENNA_ROUND_ROBIN;
+    if (my_strcmp(text, "least-loaded") == 0) return ANTENNA_LEAST_LOADED;
+    if (my_strcmp(text, "spatial") == 0) return ANTENNA_SPATIAL;
+    throw "Invalid antenna policy (expected round-robin, least-loaded or spatial)";
+}
+
+DevicePlacement CommandLine::parsePlacement(const char* text) {
+    if (my_strcmp(text, "materialized") == 0) return PLACEMENT_MATERIALIZED;
+    if (my_strcmp(text, "lazy") == 0) return PLACEMENT_LAZY;
+    throw "Invalid placement (expected materialized or lazy)";
+}
+
+CapacityKernel CommandLine::parseKernel(const char* text) {
+    if (my_strcmp(text, "auto") == 0) return KERNEL_AUTO;
+    if (my_strcmp(text, "scalar") == 0) return KERNEL_SCALAR;
+    if (my_strcmp(text, "sse4") == 0) return KERNEL_SSE41;
+    if (my_strcmp(text, "avx2") == 0) return KERNEL_AVX2;
+    throw "Invalid kernel (expected auto, scalar, sse4 or avx2)";
+}
+
+ResultFormat CommandLine::parseResultFormat(const char* text) {
+    if (my_strcmp(text, "csv") == 0) return RESULTS_CSV;
+    if (my_strcmp(text, "jsonl") == 0) return RESULTS_JSONL;
+    if (my_strcmp(text, "binary") == 0) return RESULTS_BINARY;
+    throw "Invalid results format (expected csv, jsonl or binary)";
+}
+
+Verbosity CommandLine::parseVerbosity(const char* text) {
+    if (my_strcmp(text, "summary") == 0) return VERBOSITY_SUMMARY;
+    if (my_strcmp(text, "channel") == 0) return VERBOSITY_CHANNEL;
+    if (my_strcmp(text, "device") == 0) return VERBOSITY_DEVICE;
+    throw "Invalid verbosity (expected summary, channel or device)";
+}
+
+// Any option switches to batch mode: the selected simulations run without
+// the menu and the process exits when they finish.
+RunOptions CommandLine::parse(int argc, char* argv[]) {
+    RunOptions options;
+    options.configFile = "input.txt";
+    options.batch = false;
+    options.showHelp = false;
+    options.generations = RUN_ALL;
+    options.iterations = 1;
+    options.output = OUTPUT_DIRECT;
+    options.verbosity = VERBOSITY_DEVICE;
+    options.threads = 0;
+    options.towers = 0;
+    options.cores = 0;
+    options.dynamicSeconds = 0;
+    options.corePolicy = CORE_LEAST_LOADED;
+    options.antennaPolicy = ANTENNA_ROUND_ROBIN;
+    options.placement = PLACEMENT_MATERIALIZED;
+    options.kernel = KERNEL_AUTO;
+    options.resultsFile = nullptr;
+    options.resultsFormat = RESULTS_CSV;
+    options.sweepCount = 0;
+    
+    bool haveConfig = false;
+    unsigned int given = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        
+        if (arg[0] != '-') {
+            if (haveConfig) {
+                throw "Only one configuration file may be given";
+            }
+            options.configFile = arg;
+            haveConfig = true;
+            continue;
+        }
+        
+        if (my_strcmp(arg, "--help") == 0 || my_strcmp(arg, "-h") == 0) {
+            options.showHelp = true;
+            continue;
+        }
+        
+        if (i + 1 >= argc) {
+            throw "Missing value for command line option";
+        }
+        const char* value = argv[++i];
+        
+        if (my_strcmp(arg, "--run") == 0) {
+            options.generations = parseGenerations(value);
+        } else if (my_strcmp(arg, "--iterations") == 0) {
+            options.iterations = parseCount(value);
+            given |= OPT_ITERATIONS;
+        } else if (my_strcmp(arg, "--output") == 0) {
+            options.output = parseOutputMode(value);
+            given |= OPT_OUTPUT;
+        } else if (my_strcmp(arg, "--verbosity") == 0) {
+            options.verbosity = parseVerbosity(value);
+            given |= OPT_VERBOSITY;
+        } else if (my_strcmp(arg, "--threads") == 0) {
+            options.threads = parseCount(value);
+        } else if (my_strcmp(arg, "--towers") == 0) {
+            options.towers = parseCount(value);
+            given |= OPT_TOWERS;
+        } else if (my_strcmp(arg, "--cores") == 0) {
+            options.cores = parseCount(value);
+            given |= OPT_CORES;
+        } else if (my_strcmp(arg, "--core-policy") == 0) {
+            options.corePolicy = parseCorePolicy(value);
+            given |= OPT_CORE_POLICY;
+        } else if (my_strcmp(arg, "--antenna-policy") == 0) {
+            options.antennaPolicy = parseAntennaPolicy(value);
+            given |= OPT_ANTENNA_POLICY;
+        } else if (my_strcmp(arg, "--placement") == 0) {
+            options.placement = parsePlacement(value);
+            given |= OPT_PLACEMENT;
+        } else if (my_strcmp(arg, "--kernel") == 0) {
+            options.kernel = parseKernel(value);
+            given |= OPT_KERNEL;
+        } else if (my_strcmp(arg, "--results") == 0) {
+            options.resultsFile = value;
+            given |= OPT_RESULTS;
+        } else if (my_strcmp(arg, "--results-format") == 0) {
+            options.resultsFormat = parseResultFormat(value);
+            given |= OPT_RESULTS;
+        } else if (my_strcmp(arg, "--dynamic") == 0) {
+            options.dynamicSeconds = parseCount(value);
+            given |= OPT_DYNAMIC;
+        } else if (my_strcmp(arg, "--sweep") == 0) {
+            if (options.sweepCount == MAX_SWEEP_AXES) {
+                throw "Too many --sweep axes";
+            }
+            options.sweepSpecs[options.sweepCount++] = value;
+        } else {
+            throw "Unknown command line option (see --help)";
+        }
+        options.batch = true;
+    }
+    
+    // The mode is picked in this order: sweep, dynamic, network, single tower
+    if (options.sweepCount > 0) {
+        if (given & ~SWEEP_OPTIONS) {
+            throw "Option not available with --sweep (see --help)";
+        }
+    } else if (options.dynamicSeconds > 0) {
+        if (given & ~DYNAMIC_OPTIONS) {
+            throw "Option not available with --dynamic (see --help)";
+        }
+    } else if (options.towers > 0) {
+        if (given & ~NETWORK_OPTIONS) {
+            throw "Option not available with --towers (see --help)";
+        }
+    } else if (given & OPT_CORES) {
+        throw "--cores needs --towers";
+    } else if (given & OPT_KERNEL) {
+        throw "--kernel needs --sweep";
+    }
+    
+    return options;
+}
+
+void CommandLine::printUsage(const char* program) {
+    io.outputstring("Usage: ");
+    io.outputstring(program);
+    io.outputstring(" [config-file] [options]");
+    io.terminate();
+    io.terminate();
+    io.outputstring("Without options the interactive menu is shown.");
+    io.terminate();
+    io.outputstring("Any option runs in batch mode and exits when done:");
+    io.terminate();
+    io.outputstring("  --run LIST          Generations to run, e.g. 2G,4G or all (default: all)");
+    io.terminate();
+    io.outputstring("  --iterations N      Repeat the selected simulations N times (default: 1)");
+    io.terminate();
+    io.outputstring("  --output MODE       direct, buffered (parallel, ordered) or null (default: direct)");
+    io.terminate();
+    io.outputstring("  --verbosity LEVEL   summary (aggregates only), channel (+ per-core load and");
+    io.terminate();
+    io.outputstring("                      first-channel totals) or device (+ device IDs, default)");
+    io.terminate();
+    io.outputstring("  --threads N         Worker threads (default: hardware concurrency)");
+    io.terminate();
+    io.outputstring("  --towers N          Simulate a grid of N towers sharing a core pool;");
+    io.terminate();
+    io.outputstring("                      users overflowing a tower spill to its neighbours");
+    io.terminate();
+    io.outputstring("  --cores N           Size of the shared core pool (default: enough for");
+    io.terminate();
+    io.outputstring("                      every tower)");
+    io.terminate();
+    io.outputstring("  --core-policy P     Spread 4G/5G users over cores: least-loaded, p2c");
+    io.terminate();
+    io.outputstring("                      (power of two choices) or hash (default: least-loaded)");
+    io.terminate();
+    io.outputstring("  --antenna-policy P  Spread users over a channel's MIMO antennas:");
+    io.terminate();
+    io.outputstring("                      round-robin, least-loaded or spatial (default: round-robin)");
+    io.terminate();
+    io.outputstring("  --placement P       materialized (a device pool) or lazy (devices derived");
+    io.terminate();
+    io.outputstring("                      from the tower load when reported; default: materialized)");
+    io.terminate();
+    io.outputstring("  --dynamic SECONDS   Simulate arrivals and departures over time and");
+    io.terminate();
+    io.outputstring("                      print utilization per tick");
+    io.terminate();
+    io.outputstring("  --sweep KEY=A:B[:S] Sweep a config key from A to B in steps of S and");
+    io.terminate();
+    io.outputstring("                      print one CSV row per point (repeatable)");
+    io.terminate();
+    io.outputstring("  --kernel K          Capacity kernel for sweeps: auto, scalar, sse4 or");
+    io.terminate();
+    io.outputstring("                      avx2 (default: auto, the widest the CPU supports)");
+    io.terminate();
+    io.outputstring("  --results FILE      Also write one machine-readable record per simulation");
+    io.terminate();
+    io.outputstring("                      (or sweep point and generation) to FILE");
+    io.terminate();
+    io.outputstring("  --results-format F  csv, jsonl or binary (default: csv)");
+    io.terminate();
+    io.outputstring("  --help              Show this message");
+    io.terminate();
+    io.terminate();
+    io.outputstring("--sweep, --dynamic and --towers pick the mode (in that order); options");
+    io.terminate();
+    io.outputstring("the mode does not use are rejected.");
+    io.terminate();
+}
@@ -0,0 +1,64 @@
+// CommandLine.h
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#define RUN_2G 0x1u
+#define RUN_3G 0x2u
+#define RUN_4G 0x4u
+#define RUN_5G 0x8u
+#define RUN_ALL (RUN_2G | RUN_3G | RUN_4G | RUN_5G)
+
+#include "CorePool.h"
+#include "CapacityBatch.h"
+#include "ResultEncoder.h"
+#include "OutputSink.h"
+#include "CellTower.h"
+
+#define MAX_SWEEP_AXES 8
+
+enum OutputMode {
+    OUTPUT_DIRECT,      // Sequential runs written straight to stdout
+    OUTPUT_BUFFERED,    // Parallel runs captured and printed in 2G->5G order
+    OUTPUT_NULL         // Reports are discarded (benchmarking)
+};
+
+struct RunOptions {
+    const char* configFile;
+    bool batch;
+    bool showHelp;
+    unsigned int generations;
+    unsigned int iterations;
+    OutputMode output;
+    Verbosity verbosity;
+    unsigned int threads;       // 0 selects the hardware thread count
+    unsigned int towers;        // 0 runs the single-tower simulations
+    unsigned int cores;         // Shared core pool size; 0 sizes it per tower
+    unsigned int dynamicSeconds; // Simulated time for event-driven runs; 0 is off
+    CorePolicy corePolicy;
+    AntennaPolicy antennaPolicy;
+    DevicePlacement placement;
+    CapacityKernel kernel;          // Vector kernel for sweeps
+    const char* resultsFile;        // Machine-readable records; null is off
+    ResultFormat resultsFormat;
+    const char* sweepSpecs[MAX_SWEEP_AXES];
+    unsigned int sweepCount;
+};
+
+class CommandLine {
+public:
+    static RunOptions parse(int argc, char* argv[]);
+    static void printUsage(const char* program);
+    
+private:
+    static unsigned int parseGenerations(const char* list);
+    static unsigned int parseCount(const char* text);
+    static OutputMode parseOutputMode(const char* text);
+    static CorePolicy parseCorePolicy(const char* text);
+    static AntennaPolicy parseAntennaPolicy(const char* text);
+    static DevicePlacement parsePlacement(const char* text);
+    static CapacityKernel parseKernel(const char* text);
+    static ResultFormat parseResultFormat(const char* text);
+    static Verbosity parseVerbosity(const char* text);
+};
+
+#endif
@@ -2,13 +2,18 @@
 #include "ConfigParser.h"
 #include "StringUtils.h"
 #include "basicIO.h"
+#include <cstddef>
 
 extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
 
 #define SYS_OPEN 2
 #define SYS_READ 0
 #define SYS_CLOSE 3
+#define SYS_LSEEK 8
 #define O_RDONLY 0
+#define SEEK_SET 0
+#define SEEK_END 2
+#define EINTR 4
 
 const char* ConfigParser::findColon(const char* str) {
     while (*str) {
@@ -34,98 +39,181 @@ unsigned int ConfigParser::extractValue(const char* line) {
     return result;
 }
 
-void ConfigParser::parseLine(const char* line, SimulationConfig& config) {
-    if (line[0] == '\0' || line[0] == '#') return;
-    
-    // 2G Configuration
-    if (my_strstr(line, "2G_USERS:")) {
-        config.config2G.users = extractValue(line);
-    } else if (my_strstr(line, "2G_BANDWIDTH:")) {
-        config.config2G.bandwidth = extractValue(line);
-    } else if (my_strstr(line, "2G_CHANNEL_BW:")) {
-        config.config2G.channelBw = extractValue(line);
-    } else if (my_strstr(line, "2G_USERS_PER_CHANNEL:")) {
-        config.config2G.usersPerChannel = extractValue(line);
-    } else if (my_strstr(line, "2G_DATA_MESSAGES:")) {
-        config.config2G.dataMessages = extractValue(line);
-    } else if (my_strstr(line, "2G_VOICE_MESSAGES:")) {
-        config.config2G.voiceMessages = extractValue(line);
-    } else if (my_strstr(line, "2G_OVERHEAD")) {
-        config.config2G.overhead = extractValue(line);
-    }
-    // 3G Configuration
-    else if (my_strstr(line, "3G_USERS:")) {
-        config.config3G.users = extractValue(line);
-    } else if (my_strstr(line, "3G_BANDWIDTH:")) {
-        config.config3G.bandwidth = extractValue(line);
-    } else if (my_strstr(line, "3G_CHANNEL_BW:")) {
-        config.config3G.channelBw = extractValue(line);
-    } else if (my_strstr(line, "3G_USERS_PER_CHANNEL:")) {
-        config.config3G.usersPerChannel = extractValue(line);
-    } else if (my_strstr(line, "3G_MESSAGES_PER_USER:")) {
-        config.config3G.messagesPerUser = extractValue(line);
-    } else if (my_strstr(line, "3G_OVERHEAD")) {
-        config.config3G.overhead = extractValue(line);
+// Every key maps straight to the offset of its field in SimulationConfig
+struct ConfigKey {
+    const char* name;
+    unsigned int offset;
+};
+
+static constexpr ConfigKey CONFIG_KEYS[] = {
+    {"2G_USERS",              offsetof(SimulationConfig, config2G.users)},
+    {"2G_BANDWIDTH",          offsetof(SimulationConfig, config2G.bandwidth)},
+    {"2G_CHANNEL_BW",         offsetof(SimulationConfig, config2G.channelBw)},
+    {"2G_USERS_PER_CHANNEL",  offsetof(SimulationConfig, config2G.usersPerChannel)},
+    {"2G_DATA_MESSAGES",      offsetof(SimulationConfig, config2G.dataMessages)},
+    {"2G_VOICE_MESSAGES",     offsetof(SimulationConfig, config2G.voiceMessages)},
+    {"2G_OVERHEAD",           offsetof(SimulationConfig, config2G.overhead)},
+    {"3G_USERS",              offsetof(SimulationConfig, config3G.users)},
+    {"3G_BANDWIDTH",          offsetof(SimulationConfig, config3G.bandwidth)},
+    {"3G_CHANNEL_BW",         offsetof(SimulationConfig, config3G.channelBw)},
+    {"3G_USERS_PER_CHANNEL",  offsetof(SimulationConfig, config3G.usersPerChannel)},
+    {"3G_MESSAGES_PER_USER",  offsetof(SimulationConfig, config3G.messagesPerUser)},
+    {"3G_OVERHEAD",           offsetof(SimulationConfig, config3G.overhead)},
+    {"4G_USERS",              offsetof(SimulationConfig, config4G.users)},
+    {"4G_BANDWIDTH",          offsetof(SimulationConfig, config4G.bandwidth)},
+    {"4G_CHANNEL_BW",         offsetof(SimulationConfig, config4G.channelBw)},
+    {"4G_USERS_PER_CHANNEL",  offsetof(SimulationConfig, config4G.usersPerChannel)},
+    {"4G_ANTENNAS",           offsetof(SimulationConfig, config4G.antennas)},
+    {"4G_MESSAGES_PER_USER",  offsetof(SimulationConfig, config4G.messagesPerUser)},
+    {"4G_OVERHEAD",           offsetof(SimulationConfig, config4G.overhead)},
+    {"5G_USERS",              offsetof(SimulationConfig, config5G.users)},
+    {"5G_BANDWIDTH",          offsetof(SimulationConfig, config5G.bandwidth)},
+    {"5G_CHANNEL_BW",         offsetof(SimulationConfig, config5G.channelBw)},
+    {"5G_USERS_PER_MHZ",      offsetof(SimulationConfig, config5G.usersPerMHz)},
+    {"5G_ANTENNAS",           offsetof(SimulationConfig, config5G.antennas)},
+    {"5G_MESSAGES_PER_USER",  offsetof(SimulationConfig, config5G.messagesPerUser)},
+    {"5G_OVERHEAD",           offsetof(SimulationConfig, config5G.overhead)},
+    {"DYNAMIC_ARRIVAL_RATE",  offsetof(SimulationConfig, dynamic.arrivalRate)},
+    {"DYNAMIC_SESSION_MS",    offsetof(SimulationConfig, dynamic.sessionMs)},
+    {"DYNAMIC_TICK_MS",       offsetof(SimulationConfig, dynamic.tickMs)},
+    {"CORE_CAPACITY",         offsetof(SimulationConfig, coreCapacity)},
+};
+
+static constexpr unsigned int CONFIG_KEY_COUNT = sizeof(CONFIG_KEYS) / sizeof(CONFIG_KEYS[0]);
+static constexpr unsigned int KEY_TABLE_SIZE = 128;
+static constexpr unsigned char KEY_SLOT_EMPTY = 0xFF;
+
+static constexpr unsigned int keyLength(const char* key) {
+    unsigned int len = 0;
+    while (key[len] != '\0') len++;
+    return len;
+}
+
+// Seeded FNV-1a; the seed is chosen at compile time so that no two keys
+// share a slot, which turns the table into a perfect hash.
+static constexpr unsigned int hashKey(const char* key, unsigned int len, unsigned int seed) {
+    unsigned int hash = 2166136261u ^ seed;
+    for (unsigned int i = 0; i < len; ++i) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
     }
-    // 4G Configuration
-    else if (my_strstr(line, "4G_USERS:")) {
-        config.config4G.users = extractValue(line);
-    } else if (my_strstr(line, "4G_BANDWIDTH:")) {
-        config.config4G.bandwidth = extractValue(line);
-    } else if (my_strstr(line, "4G_CHANNEL_BW:")) {
-        config.config4G.channelBw = extractValue(line);
-    } else if (my_strstr(line, "4G_USERS_PER_CHANNEL:")) {
-        config.config4G.usersPerChannel = extractValue(line);
-    } else if (my_strstr(line, "4G_ANTENNAS:")) {
-        config.config4G.antennas = extractValue(line);
-    } else if (my_strstr(line, "4G_MESSAGES_PER_USER:")) {
-        config.config4G.messagesPerUser = extractValue(line);
-    } else if (my_strstr(line, "4G_OVERHEAD")) {
-        config.config4G.overhead = extractValue(line);
+    return hash;
+}
+
+struct KeyTable {
+    unsigned int seed;
+    unsigned char slots[KEY_TABLE_SIZE];
+};
+
+static constexpr KeyTable buildKeyTable() {
+    KeyTable table = {0, {}};
+    for (unsigned int seed = 1; seed < 100000; ++seed) {
+        for (unsigned int i = 0; i < KEY_TABLE_SIZE; ++i) {
+            table.slots[i] = KEY_SLOT_EMPTY;
+        }
+        
+        bool collision = false;
+        for (unsigned int k = 0; k < CONFIG_KEY_COUNT && !collision; ++k) {
+            const char* name = CONFIG_KEYS[k].name;
+            unsigned int slot = hashKey(name, keyLength(name), seed) & (KEY_TABLE_SIZE - 1);
+            if (table.slots[slot] != KEY_SLOT_EMPTY) {
+                collision = true;
+            } else {
+                table.slots[slot] = (unsigned char)k;
+            }
+        }
+        
+        if (!collision) {
+            table.seed = seed;
+            return table;
+        }
     }
-    // 5G Configuration
-    else if (my_strstr(line, "5G_USERS:")) {
-        config.config5G.users = extractValue(line);
-    } else if (my_strstr(line, "5G_BANDWIDTH:")) {
-        config.config5G.bandwidth = extractValue(line);
-    } else if (my_strstr(line, "5G_CHANNEL_BW:")) {
-        config.config5G.channelBw = extractValue(line);
-    } else if (my_strstr(line, "5G_USERS_PER_MHZ:")) {
-        config.config5G.usersPerMHz = extractValue(line);
-    } else if (my_strstr(line, "5G_ANTENNAS:")) {
-        config.config5G.antennas = extractValue(line);
-    } else if (my_strstr(line, "5G_MESSAGES_PER_USER:")) {
-        config.config5G.messagesPerUser = extractValue(line);
-    } else if (my_strstr(line, "5G_OVERHEAD")) {
-        config.config5G.overhead = extractValue(line);
+    return table;
+}
+
+static constexpr KeyTable KEY_TABLE = buildKeyTable();
+static_assert(KEY_TABLE.seed != 0, "No perfect hash seed found for configuration keys");
+
+unsigned int* ConfigParser::findField(SimulationConfig& config, const char* key, unsigned int length) {
+    unsigned int slot = hashKey(key, length, KEY_TABLE.seed) & (KEY_TABLE_SIZE - 1);
+    unsigned char index = KEY_TABLE.slots[slot];
+    if (index == KEY_SLOT_EMPTY) return nullptr;
+    
+    const char* name = CONFIG_KEYS[index].name;
+    for (unsigned int i = 0; i < length; ++i) {
+        if (name[i] != key[i]) return nullptr;
     }
-    // Core Configuration
-    else if (my_strstr(line, "CORE_CAPACITY:")) {
-        config.coreCapacity = extractValue(line);
+    if (name[length] != '\0') return nullptr;
+    
+    return (unsigned int*)((char*)&config + CONFIG_KEYS[index].offset);
+}
+
+void ConfigParser::parseLine(const char* line, SimulationConfig& config) {
+    if (line[0] == '\0' || line[0] == '#') return;
+    
+    const char* colon = findColon(line);
+    if (!colon) return;
+    
+    // Key is the text before the colon without surrounding blanks
+    const char* keyStart = line;
+    while (*keyStart == ' ' || *keyStart == '\t') keyStart++;
+    const char* keyEnd = colon;
+    while (keyEnd > keyStart && (keyEnd[-1] == ' ' || keyEnd[-1] == '\t')) keyEnd--;
+    
+    unsigned int* field = findField(config, keyStart, (unsigned int)(keyEnd - keyStart));
+    if (field) {
+        *field = extractValue(line);
     }
 }
 
-bool ConfigParser::readLine(int fd, char* buffer, int maxLen) {
-    int i = 0;
-    char ch;
+// Reads the whole file with as few read calls as possible. Regular files
+// are sized up front; pipes fall back to a doubling buffer.
+char* ConfigParser::loadFile(int fd, unsigned int& length) {
+    long size = syscall3(SYS_LSEEK, fd, 0, SEEK_END);
+    if (size < 0 || syscall3(SYS_LSEEK, fd, 0, SEEK_SET) < 0) {
+        size = 65536;
+    }
+    
+    unsigned long capacity = (unsigned long)size + 1;
+    char* data = new char[capacity];
+    unsigned long total = 0;
     
-    while (i < maxLen - 1) {
-        long bytes = syscall3(SYS_READ, fd, (long)&ch, 1);
-        if (bytes <= 0) {
-            buffer[i] = '\0';
-            return (i > 0);
+    while (true) {
+        if (total + 1 == capacity) {
+            char* grown = new char[capacity * 2];
+            for (unsigned long i = 0; i < total; ++i) grown[i] = data[i];
+            delete[] data;
+            data = grown;
+            capacity *= 2;
         }
         
-        if (ch == '\n') {
-            buffer[i] = '\0';
-            return true;
+        long bytes = syscall3(SYS_READ, fd, (long)(data + total), capacity - 1 - total);
+        if (bytes == -EINTR) continue;
+        if (bytes < 0) {
+            delete[] data;
+            throw "Cannot read configuration file";
         }
-        
-        buffer[i++] = ch;
+        if (bytes == 0) break;
+        total += bytes;
     }
     
-    buffer[i] = '\0';
-    return true;
+    data[total] = '\0';
+    length = (unsigned int)total;
+    return data;
+}
+
+// Terminates the line at cursor in place and advances cursor past it
+char* ConfigParser::nextLine(char*& cursor, char* end) {
+    if (cursor >= end) return nullptr;
+    
+    char* line = cursor;
+    while (cursor < end && *cursor != '\n') cursor++;
+    
+    if (cursor < end) {
+        *cursor = '\0';
+        cursor++;
+    }
+    return line;
 }
 
 SimulationConfig ConfigParser::parseFile(const char* filename) {
@@ -135,6 +223,7 @@ SimulationConfig ConfigParser::parseFile(const char* filename) {
     config.config3G = {0, 0, 0, 0, 0, 0};
     config.config4G = {0, 0, 0, 0, 0, 0, 0};
     config.config5G = {0, 0, 0, 0, 0, 0, 0};
+    config.dynamic = {200, 60000, 1000};
     config.coreCapacity = 10000;
     
     long fd = syscall3(SYS_OPEN, (long)filename, O_RDONLY, 0);
@@ -142,12 +231,23 @@ SimulationConfig ConfigParser::parseFile(const char* filename) {
         throw "Cannot open configuration file";
     }
     
-    char buffer[256];
-    while (readLine(fd, buffer, 256)) {
-        parseLine(buffer, config);
+    unsigned int length = 0;
+    char* data = nullptr;
+    try {
+        data = loadFile(fd, length);
+    } catch (...) {
+        syscall3(SYS_CLOSE, fd, 0, 0);
+        throw;
     }
-    
     syscall3(SYS_CLOSE, fd, 0, 0);
     
+    char* cursor = data;
+    char* end = data + length;
+    while (char* line = nextLine(cursor, end)) {
+        parseLine(line, config);
+    }
+    
+    delete[] data;
+    
     return config;
 }
\ No newline at end of file
@@ -41,20 +41,30 @@ struct Config5G {
     unsigned int overhead;
 };
 
+// Traffic model for time-stepped runs (--dynamic); optional in the file
+struct DynamicConfig {
+    unsigned int arrivalRate;       // Session requests per second (Poisson)
+    unsigned int sessionMs;         // Mean session length (exponential)
+    unsigned int tickMs;            // Utilization sampling interval
+};
+
 struct SimulationConfig {
     Config2G config2G;
     Config3G config3G;
     Config4G config4G;
     Config5G config5G;
+    DynamicConfig dynamic;
     unsigned int coreCapacity;
 };
 
 class ConfigParser {
 public:
     static SimulationConfig parseFile(const char* filename);
+    static unsigned int* findField(SimulationConfig& config, const char* key, unsigned int length);
     
 private:
-    static bool readLine(int fd, char* buffer, int maxLen);
+    static char* loadFile(int fd, unsigned int& length);
+    static char* nextLine(char*& cursor, char* end);
     static void parseLine(const char* line, SimulationConfig& config);
     static unsigned int extractValue(const char* line);
     static const char* findColon(const char* str);
@@ -0,0 +1,280 @@
+// CorePool.cpp
+#include "CorePool.h"
+#include "OutputSink.h"
+
+// Virtual nodes per core on the consistent-hash ring
+#define RING_POINTS_PER_CORE 64
+// Cores listed one per line in the report; the rest are summarized
+#define MAX_LISTED_CORES 16
+
+static unsigned int hashKey(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((x ^ (x >> 31)) >> 32);
+}
+
+CorePool::CorePool(CellularCore** corePool, unsigned int count, CorePolicy corePolicy)
+    : cores(corePool), coreCount(count), policy(corePolicy), tree(nullptr), leafBase(1),
+      ringPoints(nullptr), ringCores(nullptr), ringSize(0),
+      rngState(0x2545F4914F6CDD1DULL), admitted(0), refused(0) {
+    if (policy == CORE_LEAST_LOADED) {
+        while (leafBase < coreCount) leafBase *= 2;
+        tree = new unsigned int[2 * leafBase];
+        for (unsigned int i = 0; i < leafBase; ++i) {
+            tree[leafBase + i] = (i < coreCount) ? i : NO_CORE;
+        }
+        for (unsigned int node = leafBase - 1; node >= 1; --node) {
+            tree[node] = betterCore(tree[2 * node], tree[2 * node + 1]);
+        }
+    } else if (policy == CORE_CONSISTENT_HASH) {
+        buildRing();
+    }
+}
+
+CorePool::~CorePool() {
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        delete cores[c];
+    }
+    delete[] cores;
+    delete[] tree;
+    delete[] ringPoints;
+    delete[] ringCores;
+}
+
+const char* CorePool::getPolicyName(CorePolicy corePolicy) {
+    switch (corePolicy) {
+        case CORE_LEAST_LOADED: return "least-loaded";
+        case CORE_POWER_OF_TWO: return "power-of-two-choices";
+        case CORE_CONSISTENT_HASH: return "consistent-hash";
+    }
+    return "unknown";
+}
+
+// Less loaded wins, ties go to the lower index; a full core never wins
+unsigned int CorePool::betterCore(unsigned int a, unsigned int b) const {
+    if (a != NO_CORE && cores[a]->getCurrentLoad() >= cores[a]->getCapacity()) a = NO_CORE;
+    if (b != NO_CORE && cores[b]->getCurrentLoad() >= cores[b]->getCapacity()) b = NO_CORE;
+    if (a == NO_CORE) return b;
+    if (b == NO_CORE) return a;
+    return (cores[b]->getCurrentLoad() < cores[a]->getCurrentLoad()) ? b : a;
+}
+
+void CorePool::updateTree(unsigned int core) {
+    for (unsigned int node = (leafBase + core) / 2; node >= 1; node /= 2) {
+        tree[node] = betterCore(tree[2 * node], tree[2 * node + 1]);
+    }
+}
+
+// Ring points are sorted with a four-pass LSD radix sort
+void CorePool::buildRing() {
+    ringSize = coreCount * RING_POINTS_PER_CORE;
+    if (ringSize == 0) return;
+    
+    ringPoints = new unsigned int[ringSize];
+    ringCores = new unsigned int[ringSize];
+    unsigned int* points = new unsigned int[ringSize];
+    unsigned int* owners = new unsigned int[ringSize];
+    
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        for (unsigned int v = 0; v < RING_POINTS_PER_CORE; ++v) {
+            unsigned int i = c * RING_POINTS_PER_CORE + v;
+            ringPoints[i] = hashKey(((unsigned long long)c << 32) | v);
+            ringCores[i] = c;
+        }
+    }
+    
+    for (unsigned int shift = 0; shift < 32; shift += 8) {
+        unsigned int counts[257] = {0};
+        for (unsigned int i = 0; i < ringSize; ++i) {
+            counts[((ringPoints[i] >> shift) & 0xFF) + 1]++;
+        }
+        for (unsigned int b = 0; b < 256; ++b) {
+            counts[b + 1] += counts[b];
+        }
+        for (unsigned int i = 0; i < ringSize; ++i) {
+            unsigned int dest = counts[(ringPoints[i] >> shift) & 0xFF]++;
+            points[dest] = ringPoints[i];
+            owners[dest] = ringCores[i];
+        }
+        for (unsigned int i = 0; i < ringSize; ++i) {
+            ringPoints[i] = points[i];
+            ringCores[i] = owners[i];
+        }
+    }
+    
+    delete[] points;
+    delete[] owners;
+}
+
+unsigned int CorePool::pickCore(unsigned int key) {
+    if (coreCount == 0) return NO_CORE;
+    
+    switch (policy) {
+        case CORE_LEAST_LOADED:
+            return tree[1];
+            
+        case CORE_POWER_OF_TWO: {
+            rngState ^= rngState << 13;
+            rngState ^= rngState >> 7;
+            rngState ^= rngState << 17;
+            unsigned int a = (unsigned int)(rngState % coreCount);
+            unsigned int b = (unsigned int)((rngState >> 32) % coreCount);
+            return (cores[b]->getCurrentLoad() < cores[a]->getCurrentLoad()) ? b : a;
+        }
+        
+        case CORE_CONSISTENT_HASH: {
+            unsigned int point = hashKey(key);
+            unsigned int low = 0;
+            unsigned int high = ringSize;
+            while (low < high) {
+                unsigned int mid = (low + high) / 2;
+                if (ringPoints[mid] < point) low = mid + 1;
+                else high = mid;
+            }
+            return ringCores[(low < ringSize) ? low : 0];
+        }
+    }
+    return NO_CORE;
+}
+
+unsigned int CorePool::admit(unsigned int key) {
+    unsigned int core = pickCore(key);
+    if (core == NO_CORE || !cores[core]->addLoad(1)) {
+        refused++;
+        return NO_CORE;
+    }
+    
+    admitted++;
+    if (tree) {
+        updateTree(core);
+    }
+    return core;
+}
+
+// One admit() at a time raises the emptiest non-full core, so the loads
+// end up water-filled: every core is topped up to a common level, and the
+// users left over go one each to the lowest-indexed cores still on that
+// level with room. The level is found by binary search on the users it
+// takes to reach it.
+unsigned int CorePool::admitLeastLoaded(unsigned int count) {
+    if (policy != CORE_LEAST_LOADED || coreCount == 0) {
+        refused += count;
+        return 0;
+    }
+    
+    unsigned int top = 0;
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        if (cores[c]->getCapacity() > top) top = cores[c]->getCapacity();
+    }
+    
+    // Users needed to bring every core up to level (or to its capacity)
+    auto fillTo = [this](unsigned int level) {
+        unsigned long long users = 0;
+        for (unsigned int c = 0; c < coreCount; ++c) {
+            unsigned int load = cores[c]->getCurrentLoad();
+            unsigned int ceiling = cores[c]->getCapacity();
+            if (level < ceiling) ceiling = level;
+            if (ceiling > load) users += ceiling - load;
+        }
+        return users;
+    };
+    
+    // Highest level reachable with count users
+    unsigned int low = 0;
+    unsigned int high = top;
+    while (low < high) {
+        unsigned int mid = low + (high - low + 1) / 2;
+        if (fillTo(mid) <= count) low = mid;
+        else high = mid - 1;
+    }
+    
+    unsigned int placed = (unsigned int)fillTo(low);
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        unsigned int load = cores[c]->getCurrentLoad();
+        unsigned int target = (low < cores[c]->getCapacity()) ? low : cores[c]->getCapacity();
+        if (target > load) {
+            cores[c]->addLoad(target - load);
+        }
+    }
+    for (unsigned int c = 0; c < coreCount && placed < count; ++c) {
+        if (cores[c]->getCurrentLoad() == low && cores[c]->addLoad(1)) {
+            placed++;
+        }
+    }
+    
+    for (unsigned int node = leafBase - 1; node >= 1; --node) {
+        tree[node] = betterCore(tree[2 * node], tree[2 * node + 1]);
+    }
+    
+    admitted += placed;
+    refused += count - placed;
+    return placed;
+}
+
+void CorePool::release(unsigned int core) {
+    if (core >= coreCount) return;
+    
+    cores[core]->releaseLoad(1);
+    if (tree) {
+        updateTree(core);
+    }
+}
+
+template<typename Sink>
+void CorePool::displayUtilization(Sink& out, bool listCores) const {
+    out.append("\n--- Core Utilization (");
+    out.append(getPolicyName(policy));
+    out.append(") ---");
+    out.newline();
+    
+    if (coreCount == 0) {
+        out.append("Cores: None");
+        out.newline();
+        return;
+    }
+    
+    unsigned int minPercent = 100;
+    unsigned int maxPercent = 0;
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        unsigned int load = cores[c]->getCurrentLoad();
+        unsigned int capacity = cores[c]->getCapacity();
+        unsigned int percent = (capacity > 0) ? (unsigned int)((unsigned long long)load * 100 / capacity) : 0;
+        if (percent < minPercent) minPercent = percent;
+        if (percent > maxPercent) maxPercent = percent;
+        
+        if (listCores && c < MAX_LISTED_CORES) {
+            out.append("  Core ");
+            out.append(cores[c]->getCoreId());
+            out.append(": ");
+            out.append(load);
+            out.append("/");
+            out.append(capacity);
+            out.append(" users (");
+            out.append(percent);
+            out.append("%)");
+            out.newline();
+        }
+    }
+    if (listCores && coreCount > MAX_LISTED_CORES) {
+        out.append("  ... ");
+        out.append(coreCount - MAX_LISTED_CORES);
+        out.append(" more cores");
+        out.newline();
+    }
+    
+    out.append("Core Load Range: ");
+    out.append(minPercent);
+    out.append("% - ");
+    out.append(maxPercent);
+    out.append("%");
+    out.newline();
+    out.append("Refused by Busy Cores: ");
+    out.append(refused);
+    out.append(" users");
+    out.newline();
+}
+
+template void CorePool::displayUtilization<DirectSink>(DirectSink&, bool) const;
+template void CorePool::displayUtilization<CharBuffer>(CharBuffer&, bool) const;
+template void CorePool::displayUtilization<NullSink>(NullSink&, bool) const;
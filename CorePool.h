@@ -0,0 +1,73 @@
+// CorePool.h
+#ifndef COREPOOL_H
+#define COREPOOL_H
+
+#include "CellularCore.h"
+
+#define NO_CORE 0xFFFFFFFFu
+
+enum CorePolicy {
+    CORE_LEAST_LOADED,      // Always the emptiest core (ties: lowest index)
+    CORE_POWER_OF_TWO,      // Emptier of two randomly chosen cores
+    CORE_CONSISTENT_HASH    // Core owning the user's point on a hash ring
+};
+
+// The cores serving one tower. Each admitted user adds one unit of load
+// (standing for its messages) to the core the policy picks; a user whose
+// core is full is refused even if other cores still have room, which is
+// the throughput cost of an imbalanced policy.
+class CorePool {
+private:
+    CellularCore** cores;
+    unsigned int coreCount;
+    CorePolicy policy;
+    
+    // Least loaded: tournament tree over the cores, tree[1] is the winner
+    unsigned int* tree;
+    unsigned int leafBase;
+    
+    // Consistent hash: sorted ring of virtual nodes
+    unsigned int* ringPoints;
+    unsigned int* ringCores;
+    unsigned int ringSize;
+    
+    unsigned long long rngState;
+    unsigned int admitted;
+    unsigned int refused;
+    
+    unsigned int betterCore(unsigned int a, unsigned int b) const;
+    void updateTree(unsigned int core);
+    void buildRing();
+    unsigned int pickCore(unsigned int key);
+    
+public:
+    // Takes ownership of the cores array and every core in it
+    CorePool(CellularCore** corePool, unsigned int count, CorePolicy corePolicy);
+    ~CorePool();
+    
+    CorePool(const CorePool&) = delete;
+    CorePool& operator=(const CorePool&) = delete;
+    
+    // Returns the core serving the user with this key, or NO_CORE
+    unsigned int admit(unsigned int key);
+    
+    // Least loaded only: admits count users at once and returns how many
+    // got a core. Leaves the loads count calls to admit() would, in
+    // O(cores log capacity) instead of O(count log cores).
+    unsigned int admitLeastLoaded(unsigned int count);
+    void release(unsigned int core);
+    
+    unsigned int getCoreCount() const { return coreCount; }
+    CellularCore* getCore(unsigned int index) const { return cores[index]; }
+    CorePolicy getPolicy() const { return policy; }
+    unsigned int getAdmitted() const { return admitted; }
+    unsigned int getRefused() const { return refused; }
+    
+    static const char* getPolicyName(CorePolicy corePolicy);
+    
+    // listCores false prints only the load range and refusals
+    template<typename Sink>
+    void displayUtilization(Sink& out, bool listCores = true) const;
+};
+
+#endif
@@ -0,0 +1,60 @@
+// DevicePool.cpp
+#include "DevicePool.h"
+#include "StringUtils.h"
+
+DevicePool::DevicePool(unsigned int cap) : capacity(cap), count(0) {
+    // Five unsigned int arrays followed by the active flags
+    unsigned long words = 5UL * cap + (cap + sizeof(unsigned int) - 1) / sizeof(unsigned int);
+    arena = new unsigned int[words > 0 ? words : 1];
+    
+    deviceIds = arena;
+    assignedChannels = deviceIds + cap;
+    frequencies = assignedChannels + cap;
+    messageCounts = frequencies + cap;
+    assignedSlots = messageCounts + cap;
+    activeFlags = (bool*)(assignedSlots + cap);
+}
+
+DevicePool::~DevicePool() {
+    delete[] arena;
+}
+
+unsigned int DevicePool::addDevice(unsigned int id, unsigned int msgCount) {
+    if (count >= capacity) {
+        return NO_DEVICE;
+    }
+    
+    unsigned int index = count++;
+    deviceIds[index] = id;
+    messageCounts[index] = msgCount;
+    assignedChannels[index] = 0;
+    frequencies[index] = 0;
+    assignedSlots[index] = NO_DEVICE;
+    activeFlags[index] = false;
+    return index;
+}
+
+// Appends devices with consecutive ids continuing from the current count
+void DevicePool::addSequentialDevices(unsigned int total, unsigned int msgCount) {
+    unsigned int end = count + total;
+    if (end > capacity) end = capacity;
+    
+    for (unsigned int i = count; i < end; ++i) {
+        deviceIds[i] = i + 1;
+        messageCounts[i] = msgCount;
+        assignedChannels[i] = 0;
+        frequencies[i] = 0;
+        assignedSlots[i] = NO_DEVICE;
+        activeFlags[i] = false;
+    }
+    count = end;
+}
+
+// Names are not stored; "Device_<id>" is built on demand into buffer,
+// which must hold at least 18 bytes. Returns the name length.
+unsigned int DevicePool::formatDeviceName(unsigned int index, char* buffer) const {
+    my_strcpy(buffer, "Device_");
+    unsigned int len = 7 + my_utoa(deviceIds[index], buffer + 7);
+    buffer[len] = '\0';
+    return len;
+}
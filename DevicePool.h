@@ -0,0 +1,58 @@
+// DevicePool.h
+#ifndef DEVICEPOOL_H
+#define DEVICEPOOL_H
+
+#include "UserDevice.h"
+
+#define NO_DEVICE 0xFFFFFFFFu
+
+// Structure-of-arrays storage for all devices of a simulation. Every field
+// lives in its own contiguous array carved out of a single allocation, and
+// devices are referred to by their index in the pool.
+class DevicePool {
+private:
+    unsigned int* arena;
+    unsigned int capacity;
+    unsigned int count;
+    
+    unsigned int* deviceIds;
+    unsigned int* assignedChannels;
+    unsigned int* frequencies;
+    unsigned int* messageCounts;
+    unsigned int* assignedSlots;    // Slot inside the assigned channel
+    bool* activeFlags;
+    
+public:
+    explicit DevicePool(unsigned int cap);
+    ~DevicePool();
+    
+    DevicePool(const DevicePool&) = delete;
+    DevicePool& operator=(const DevicePool&) = delete;
+    
+    unsigned int addDevice(unsigned int id, unsigned int msgCount);
+    void addSequentialDevices(unsigned int total, unsigned int msgCount);
+    
+    // The slot is always given: releasing a device looks it up by its slot
+    void assignToChannel(unsigned int index, unsigned int channel, unsigned int freq,
+                         unsigned int slot) {
+        assignedChannels[index] = channel;
+        frequencies[index] = freq;
+        assignedSlots[index] = slot;
+    }
+    void activate(unsigned int index) { activeFlags[index] = true; }
+    void deactivate(unsigned int index) { activeFlags[index] = false; }
+    
+    unsigned int getCapacity() const { return capacity; }
+    unsigned int getCount() const { return count; }
+    unsigned int getDeviceId(unsigned int index) const { return deviceIds[index]; }
+    bool isActive(unsigned int index) const { return activeFlags[index]; }
+    unsigned int getAssignedChannel(unsigned int index) const { return assignedChannels[index]; }
+    unsigned int getAssignedSlot(unsigned int index) const { return assignedSlots[index]; }
+    unsigned int getFrequency(unsigned int index) const { return frequencies[index]; }
+    unsigned int getMessageCount(unsigned int index) const { return messageCounts[index]; }
+    
+    unsigned int formatDeviceName(unsigned int index, char* buffer) const;
+    UserDevice getDevice(unsigned int index) { return UserDevice(this, index); }
+};
+
+#endif
@@ -0,0 +1,272 @@
+// DynamicSimulation.cpp
+#include "DynamicSimulation.h"
+#include "OutputSink.h"
+#include <cmath>
+
+#define NANOS_PER_MS 1000000ULL
+#define NANOS_PER_SECOND 1000000000ULL
+#define NO_EVENT_TIME 0xFFFFFFFFFFFFFFFFULL
+#define CORE_RESERVE_BATCH 64
+
+// Marsaglia & Tsang's 256-layer exponential ziggurat: the right edge of the
+// base layer and the area of each layer
+#define EXP_TAIL_START 7.69711747013104972
+#define EXP_LAYER_AREA 3.949659822581572e-3
+#define TWO_POW_32 4294967296.0
+
+DynamicSimulation::DynamicSimulation(CellTower* cellTower, CellularCore* cellCore,
+                                     unsigned int userCapacity, const DynamicConfig& traffic,
+                                     unsigned int seconds, unsigned int seed)
+    : tower(cellTower), core(cellCore), devices(cellTower->getDevicePool()),
+      idleDevices(nullptr), idleCount(0), capacity(userCapacity), coreHeld(0),
+      meanArrivalGap(0.0), meanSession((double)traffic.sessionMs * NANOS_PER_MS),
+      tickLength((unsigned long long)traffic.tickMs * NANOS_PER_MS),
+      endTime((unsigned long long)seconds * NANOS_PER_SECOND),
+      rngState(0x9E3779B97F4A7C15ULL ^ seed), eventCount(0), arrivals(0), admitted(0),
+      blocked(0), departures(0), utilizationSum(0), tickCount(0), peakActive(0) {
+    if (traffic.arrivalRate > 0) {
+        meanArrivalGap = (double)NANOS_PER_SECOND / traffic.arrivalRate;
+    }
+    if (tickLength == 0) {
+        tickLength = NANOS_PER_SECOND;
+    }
+    buildExponentialTables();
+    
+    // Lowest device indices are handed out first
+    unsigned int total = devices->getCount();
+    idleDevices = new unsigned int[total > 0 ? total : 1];
+    for (unsigned int i = 0; i < total; ++i) {
+        idleDevices[idleCount++] = total - 1 - i;
+    }
+}
+
+DynamicSimulation::~DynamicSimulation() {
+    delete[] idleDevices;
+}
+
+// splitmix64
+unsigned long long DynamicSimulation::nextRandom() {
+    unsigned long long z = (rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void DynamicSimulation::buildExponentialTables() {
+    double edge = EXP_TAIL_START;
+    double baseWidth = EXP_LAYER_AREA / std::exp(-edge);
+    
+    expLimit[0] = (unsigned int)(edge / baseWidth * TWO_POW_32);
+    expLimit[1] = 0;
+    expWidth[0] = baseWidth / TWO_POW_32;
+    expWidth[EXP_LAYERS - 1] = edge / TWO_POW_32;
+    expHeight[0] = 1.0;
+    expHeight[EXP_LAYERS - 1] = std::exp(-edge);
+    
+    for (unsigned int i = EXP_LAYERS - 2; i > 0; --i) {
+        double outer = edge;
+        edge = -std::log(EXP_LAYER_AREA / edge + std::exp(-edge));
+        expLimit[i + 1] = (unsigned int)(edge / outer * TWO_POW_32);
+        expWidth[i] = edge / TWO_POW_32;
+        expHeight[i] = std::exp(-edge);
+    }
+}
+
+// Uniform on (0, 1), never exactly 0
+double DynamicSimulation::nextUniform() {
+    return ((nextRandom() >> 11) + 1) * (1.0 / 9007199254740993.0);
+}
+
+// Standard exponential. About 99% of draws land inside a layer and cost one
+// random number and a multiply; the rest test the layer's curved edge or
+// sample the tail beyond the base layer.
+double DynamicSimulation::nextExponential() {
+    while (true) {
+        unsigned long long bits = nextRandom();
+        unsigned int layer = (unsigned int)(bits & (EXP_LAYERS - 1));
+        unsigned int draw = (unsigned int)(bits >> 32);
+        double x = draw * expWidth[layer];
+        
+        if (draw < expLimit[layer]) {
+            return x;
+        }
+        if (layer == 0) {
+            return EXP_TAIL_START - std::log(nextUniform());
+        }
+        if (expHeight[layer] + nextUniform() * (expHeight[layer - 1] - expHeight[layer]) < std::exp(-x)) {
+            return x;
+        }
+    }
+}
+
+// Exponentially distributed gap, at least one nanosecond
+unsigned long long DynamicSimulation::nextGap(double mean) {
+    unsigned long long gap = (unsigned long long)(nextExponential() * mean);
+    return (gap > 0) ? gap : 1;
+}
+
+// The core's load is reserved in batches rather than one atomic update per
+// session. An arrival still fails only once nothing is held and the core is
+// full, that is, when every reserved unit is in use by an active session.
+bool DynamicSimulation::holdCoreUnit() {
+    if (coreHeld == 0) {
+        coreHeld = core->reserveLoad(CORE_RESERVE_BATCH);
+    }
+    return coreHeld > 0;
+}
+
+void DynamicSimulation::handleArrival(unsigned long long time) {
+    arrivals++;
+    
+    bool accepted = false;
+    if (idleCount > 0 && tower->getCurrentLoad() < capacity && holdCoreUnit()) {
+        unsigned int device = idleDevices[idleCount - 1];
+        if (tower->assignDeviceToFirstAvailable(device)) {
+            idleCount--;
+            coreHeld--;
+            accepted = true;
+            
+            SimEvent departure;
+            departure.time = time + nextGap(meanSession);
+            departure.type = EVENT_DEPARTURE;
+            departure.device = device;
+            events.push(departure);
+        }
+    }
+    
+    if (accepted) {
+        admitted++;
+        if (tower->getCurrentLoad() > peakActive) {
+            peakActive = tower->getCurrentLoad();
+        }
+    } else {
+        blocked++;
+    }
+}
+
+void DynamicSimulation::handleDeparture(const SimEvent& event) {
+    if (tower->releaseDevice(event.device)) {
+        idleDevices[idleCount++] = event.device;
+        departures++;
+        
+        coreHeld++;
+        if (coreHeld > 2 * CORE_RESERVE_BATCH) {
+            core->releaseLoad(CORE_RESERVE_BATCH);
+            coreHeld -= CORE_RESERVE_BATCH;
+        }
+    }
+}
+
+template<typename Sink>
+void DynamicSimulation::run(Sink& out) {
+    out.append("\n--- Dynamic Traffic ---");
+    out.newline();
+    out.append("Duration: ");
+    out.append((unsigned int)(endTime / NANOS_PER_SECOND));
+    out.append(" s, Tick: ");
+    out.append((unsigned int)(tickLength / NANOS_PER_MS));
+    out.append(" ms");
+    out.newline();
+    out.append("Subscribers: ");
+    out.append(devices->getCount());
+    out.append(", Capacity: ");
+    out.append(capacity);
+    out.append(" users");
+    out.newline();
+    out.newline();
+    out.append("tick,time_ms,arrivals,admitted,blocked,departures,active,utilization_pct");
+    out.newline();
+    
+    // Arrivals and ticks each have exactly one pending event, so they are
+    // kept beside the queue and only departures go through it. At equal
+    // times departures go first, then the arrival, then the tick sample.
+    unsigned long long nextArrival = (meanArrivalGap > 0.0) ? nextGap(meanArrivalGap) : NO_EVENT_TIME;
+    unsigned long long nextTick = tickLength;
+    
+    unsigned long long tickArrivals = 0;
+    unsigned long long tickAdmitted = 0;
+    unsigned long long tickBlocked = 0;
+    unsigned long long tickDepartures = 0;
+    
+    while (true) {
+        unsigned long long nextDeparture = events.isEmpty() ? NO_EVENT_TIME : events.peekTime();
+        
+        if (nextDeparture <= nextArrival && nextDeparture <= nextTick) {
+            if (nextDeparture > endTime) break;
+            eventCount++;
+            handleDeparture(events.pop());
+        } else if (nextArrival <= nextTick) {
+            if (nextArrival > endTime) break;
+            eventCount++;
+            handleArrival(nextArrival);
+            nextArrival += nextGap(meanArrivalGap);
+        } else {
+            if (nextTick > endTime) break;
+            eventCount++;
+            
+            unsigned int active = tower->getCurrentLoad();
+            unsigned int utilization = (capacity > 0) ? (unsigned int)((unsigned long long)active * 100 / capacity) : 0;
+            utilizationSum += utilization;
+            tickCount++;
+            
+            out.append(tickCount);
+            out.append(",");
+            out.append((unsigned int)(nextTick / NANOS_PER_MS));
+            out.append(",");
+            out.append((unsigned int)(arrivals - tickArrivals));
+            out.append(",");
+            out.append((unsigned int)(admitted - tickAdmitted));
+            out.append(",");
+            out.append((unsigned int)(blocked - tickBlocked));
+            out.append(",");
+            out.append((unsigned int)(departures - tickDepartures));
+            out.append(",");
+            out.append(active);
+            out.append(",");
+            out.append(utilization);
+            out.newline();
+            
+            tickArrivals = arrivals;
+            tickAdmitted = admitted;
+            tickBlocked = blocked;
+            tickDepartures = departures;
+            
+            nextTick += tickLength;
+        }
+    }
+    
+    // The core is left carrying exactly the sessions still active
+    core->releaseLoad(coreHeld);
+    coreHeld = 0;
+    
+    out.append("\n--- Dynamic Summary ---");
+    out.newline();
+    out.append("Events Processed: ");
+    out.append((unsigned int)eventCount);
+    out.newline();
+    out.append("Arrivals: ");
+    out.append((unsigned int)arrivals);
+    out.append(", Admitted: ");
+    out.append((unsigned int)admitted);
+    out.append(", Blocked: ");
+    out.append((unsigned int)blocked);
+    out.append(" (");
+    out.append((unsigned int)(arrivals > 0 ? blocked * 100 / arrivals : 0));
+    out.append("%)");
+    out.newline();
+    out.append("Departures: ");
+    out.append((unsigned int)departures);
+    out.append(", Still Active: ");
+    out.append(tower->getCurrentLoad());
+    out.newline();
+    out.append("Peak Active: ");
+    out.append(peakActive);
+    out.append(", Average Utilization: ");
+    out.append(tickCount > 0 ? (unsigned int)(utilizationSum / tickCount) : 0u);
+    out.append("%");
+    out.newline();
+}
+
+template void DynamicSimulation::run<DirectSink>(DirectSink&);
+template void DynamicSimulation::run<CharBuffer>(CharBuffer&);
+template void DynamicSimulation::run<NullSink>(NullSink&);
@@ -0,0 +1,70 @@
+// DynamicSimulation.h
+#ifndef DYNAMICSIMULATION_H
+#define DYNAMICSIMULATION_H
+
+#include "CellTower.h"
+#include "ConfigParser.h"
+#include "EventQueue.h"
+
+#define EXP_LAYERS 256
+
+// Discrete-event run of one tower over time. Session requests arrive as a
+// Poisson process from the tower's idle devices, sessions last an
+// exponentially distributed time, and departing devices free their slot.
+// Utilization is sampled once per tick.
+class DynamicSimulation {
+private:
+    CellTower* tower;
+    CellularCore* core;
+    DevicePool* devices;
+    unsigned int* idleDevices;      // Stack of devices not in a session
+    unsigned int idleCount;
+    unsigned int capacity;          // Users the tower and its core can hold
+    unsigned int coreHeld;          // Core load reserved but not yet used by a session
+    
+    EventQueue events;
+    double meanArrivalGap;          // Nanoseconds
+    double meanSession;             // Nanoseconds
+    unsigned long long tickLength;
+    unsigned long long endTime;
+    unsigned long long rngState;
+    
+    // Ziggurat for exponential gaps: layer i accepts a 32-bit draw below
+    // expLimit[i] as draw * expWidth[i]; expHeight[i] is the density at its edge
+    unsigned int expLimit[EXP_LAYERS];
+    double expWidth[EXP_LAYERS];
+    double expHeight[EXP_LAYERS];
+    
+    unsigned long long eventCount;
+    unsigned long long arrivals;
+    unsigned long long admitted;
+    unsigned long long blocked;
+    unsigned long long departures;
+    unsigned long long utilizationSum;
+    unsigned int tickCount;
+    unsigned int peakActive;
+    
+    void buildExponentialTables();
+    unsigned long long nextRandom();
+    double nextUniform();
+    double nextExponential();
+    unsigned long long nextGap(double mean);
+    bool holdCoreUnit();
+    void handleArrival(unsigned long long time);
+    void handleDeparture(const SimEvent& event);
+    
+public:
+    DynamicSimulation(CellTower* cellTower, CellularCore* cellCore, unsigned int userCapacity,
+                      const DynamicConfig& traffic, unsigned int seconds, unsigned int seed);
+    ~DynamicSimulation();
+    
+    DynamicSimulation(const DynamicSimulation&) = delete;
+    DynamicSimulation& operator=(const DynamicSimulation&) = delete;
+    
+    template<typename Sink>
+    void run(Sink& out);
+    
+    unsigned long long getEventCount() const { return eventCount; }
+};
+
+#endif
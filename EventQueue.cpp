@@ -0,0 +1,78 @@
+// EventQueue.cpp
+#include "EventQueue.h"
+
+EventQueue::EventQueue() : lastTime(0), count(0), nextTime(0), nextKnown(false) {
+    for (unsigned int i = 0; i < EVENT_BUCKETS; ++i) {
+        buckets[i].events = nullptr;
+        buckets[i].size = 0;
+        buckets[i].capacity = 0;
+    }
+    for (unsigned int w = 0; w < EVENT_BUCKET_WORDS; ++w) {
+        occupied[w] = 0;
+    }
+}
+
+EventQueue::~EventQueue() {
+    for (unsigned int i = 0; i < EVENT_BUCKETS; ++i) {
+        delete[] buckets[i].events;
+    }
+}
+
+// Slow path of push: grow the bucket, then store the event
+void EventQueue::append(Bucket& bucket, const SimEvent& event) {
+    unsigned int capacity = (bucket.capacity > 0) ? bucket.capacity * 2 : 64;
+    SimEvent* grown = new SimEvent[capacity];
+    for (unsigned int i = 0; i < bucket.size; ++i) {
+        grown[i] = bucket.events[i];
+    }
+    delete[] bucket.events;
+    bucket.events = grown;
+    bucket.capacity = capacity;
+    bucket.events[bucket.size++] = event;
+}
+
+// With bucket 0 empty, the earliest event is the minimum of the first
+// non-empty bucket. Returns that bucket's index.
+unsigned int EventQueue::findNext() {
+    if (count == 0) {
+        throw "Pop from an empty event queue";
+    }
+    
+    // Bucket 0 is empty here, though its bit may still be set
+    unsigned int w = 0;
+    unsigned long long word = occupied[0] & ~1ULL;
+    while (word == 0) word = occupied[++w];
+    unsigned int i = w * 64 + __builtin_ctzll(word);
+    
+    if (!nextKnown) {
+        const Bucket& source = buckets[i];
+        unsigned long long minTime = source.events[0].time;
+        for (unsigned int e = 1; e < source.size; ++e) {
+            if (source.events[e].time < minTime) minTime = source.events[e].time;
+        }
+        nextTime = minTime;
+        nextKnown = true;
+    }
+    return i;
+}
+
+SimEvent EventQueue::pop() {
+    // Refill bucket 0 from the first non-empty bucket: its minimum becomes
+    // the new reference time and every event in it moves to a lower bucket
+    if (buckets[0].size == 0) {
+        Bucket& source = buckets[findNext()];
+        lastTime = nextTime;
+        
+        unsigned int index = (unsigned int)(&source - buckets);
+        occupied[index / 64] &= ~(1ULL << (index % 64));
+        unsigned int moving = source.size;
+        source.size = 0;
+        for (unsigned int e = 0; e < moving; ++e) {
+            store(bucketFor(source.events[e].time, lastTime), source.events[e]);
+        }
+    }
+    
+    nextKnown = false;
+    count--;
+    return buckets[0].events[--buckets[0].size];
+}
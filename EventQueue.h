@@ -0,0 +1,99 @@
+// EventQueue.h
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#define EVENT_DEPARTURE 1
+
+#define EVENT_RADIX_BITS 4
+#define EVENT_RADIX_DIGITS (1U << EVENT_RADIX_BITS)
+#define EVENT_BUCKETS (64 / EVENT_RADIX_BITS * EVENT_RADIX_DIGITS)
+#define EVENT_BUCKET_WORDS (EVENT_BUCKETS / 64)
+
+struct SimEvent {
+    unsigned long long time;    // Nanoseconds since the start of the run
+    unsigned int type;
+    unsigned int device;
+};
+
+// Monotone radix heap with 4-bit digits. An event's bucket is the highest
+// digit in which its time differs from the last popped time, together with
+// its own value of that digit, so buckets are ordered by time and push is
+// O(1). Refilling from the first non-empty bucket moves every event in it to
+// a lower digit, so each event moves at most 16 times over its lifetime
+// rather than once per bit. A bitmap of non-empty buckets finds the first
+// one without walking empty buckets. Times pushed must not be earlier than
+// the last event popped.
+//
+// peekTime() leaves the reference time alone: it finds the earliest event
+// by scanning the first non-empty bucket and caches it for the next pop,
+// so a caller may still push events earlier than the one it peeked at.
+class EventQueue {
+private:
+    struct Bucket {
+        SimEvent* events;
+        unsigned int size;
+        unsigned int capacity;
+    };
+    
+    Bucket buckets[EVENT_BUCKETS];
+    unsigned long long occupied[EVENT_BUCKET_WORDS];   // Bit set per non-empty bucket above 0
+    unsigned long long lastTime;
+    unsigned long long count;
+    unsigned long long nextTime;    // Earliest queued time, while nextKnown
+    bool nextKnown;
+    
+    // Bucket 0 holds times equal to the last popped time. Elsewhere the
+    // differing digit of a later time is above the last time's, never 0.
+    static unsigned int bucketFor(unsigned long long time, unsigned long long last) {
+        if (time == last) {
+            return 0;
+        }
+        unsigned int digit = (63 - __builtin_clzll(time ^ last)) / EVENT_RADIX_BITS;
+        unsigned int value = (unsigned int)(time >> (digit * EVENT_RADIX_BITS)) & (EVENT_RADIX_DIGITS - 1);
+        return digit * EVENT_RADIX_DIGITS + value;
+    }
+    void store(unsigned int index, const SimEvent& event) {
+        Bucket& bucket = buckets[index];
+        if (bucket.size == bucket.capacity) {
+            append(bucket, event);
+        } else {
+            bucket.events[bucket.size++] = event;
+        }
+        occupied[index / 64] |= 1ULL << (index % 64);
+    }
+    void append(Bucket& bucket, const SimEvent& event);
+    unsigned int findNext();
+    
+public:
+    EventQueue();
+    ~EventQueue();
+    
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+    
+    void push(const SimEvent& event) {
+        store(bucketFor(event.time, lastTime), event);
+        if (nextKnown && event.time < nextTime) {
+            nextTime = event.time;
+        }
+        count++;
+    }
+    
+    SimEvent pop();
+    
+    // Time of the event pop() would return next
+    unsigned long long peekTime() {
+        if (buckets[0].size > 0) {
+            return lastTime;
+        }
+        if (!nextKnown) {
+            findNext();
+        }
+        return nextTime;
+    }
+    
+    bool isEmpty() const { return count == 0; }
+    unsigned long long getSize() const { return count; }
+};
+
+#endif
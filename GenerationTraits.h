@@ -0,0 +1,107 @@
+// GenerationTraits.h
+#ifndef GENERATIONTRAITS_H
+#define GENERATIONTRAITS_H
+
+#include "ConfigParser.h"
+#include "CellularCore.h"
+
+// How a generation divides its spectrum into channels
+enum Channelization {
+    CHANNEL_TDMA,       // Time slots per carrier
+    CHANNEL_CDMA,       // Codes per carrier
+    CHANNEL_OFDM,       // Subcarrier groups, multiplied by MIMO
+    CHANNEL_PER_MHZ     // Users per MHz, multiplied by massive MIMO
+};
+
+// Everything that tells the generations apart, resolved at compile time.
+// The capacity engine and the report are written once against these
+// members; a new generation (or a 5G numerology) is one more
+// specialization, with no runtime dispatch.
+//
+//   Config              parsed configuration block
+//   Core                core model serving the tower
+//   NAME                "2G" .. "5G"
+//   CHANNELIZATION      see Channelization
+//   MULTI_CORE          false: one core bounds the tower; true: cores are
+//                       added until the frequency limit is covered
+//   SPLIT_TRAFFIC       messages are configured as data + voice
+//   config()            the generation's block of a SimulationConfig
+//   usersPerChannel()   users per channel (per MHz) before MIMO
+//   mimoFactor()        parallel antennas (1 without MIMO)
+//   messagesPerUser()
+template<unsigned int Generation>
+struct GenerationTraits;
+
+template<>
+struct GenerationTraits<2> {
+    typedef Config2G Config;
+    typedef Core2G Core;
+    static constexpr const char* NAME = "2G";
+    static constexpr Channelization CHANNELIZATION = CHANNEL_TDMA;
+    static constexpr bool MULTI_CORE = false;
+    static constexpr bool SPLIT_TRAFFIC = true;
+
+    static const Config& config(const SimulationConfig& sim) { return sim.config2G; }
+    static unsigned int usersPerChannel(const Config& cfg) { return cfg.usersPerChannel; }
+    static unsigned int mimoFactor(const Config&) { return 1; }
+    static unsigned int messagesPerUser(const Config& cfg) { return cfg.dataMessages + cfg.voiceMessages; }
+    static Core* createCore(const Config&, unsigned int id, unsigned int capacity) {
+        return new Core(id, capacity);
+    }
+};
+
+template<>
+struct GenerationTraits<3> {
+    typedef Config3G Config;
+    typedef Core3G Core;
+    static constexpr const char* NAME = "3G";
+    static constexpr Channelization CHANNELIZATION = CHANNEL_CDMA;
+    static constexpr bool MULTI_CORE = false;
+    static constexpr bool SPLIT_TRAFFIC = false;
+
+    static const Config& config(const SimulationConfig& sim) { return sim.config3G; }
+    static unsigned int usersPerChannel(const Config& cfg) { return cfg.usersPerChannel; }
+    static unsigned int mimoFactor(const Config&) { return 1; }
+    static unsigned int messagesPerUser(const Config& cfg) { return cfg.messagesPerUser; }
+    static Core* createCore(const Config&, unsigned int id, unsigned int capacity) {
+        return new Core(id, capacity);
+    }
+};
+
+template<>
+struct GenerationTraits<4> {
+    typedef Config4G Config;
+    typedef Core4G Core;
+    static constexpr const char* NAME = "4G";
+    static constexpr Channelization CHANNELIZATION = CHANNEL_OFDM;
+    static constexpr bool MULTI_CORE = true;
+    static constexpr bool SPLIT_TRAFFIC = false;
+
+    static const Config& config(const SimulationConfig& sim) { return sim.config4G; }
+    static unsigned int usersPerChannel(const Config& cfg) { return cfg.usersPerChannel; }
+    static unsigned int mimoFactor(const Config& cfg) { return cfg.antennas; }
+    static unsigned int messagesPerUser(const Config& cfg) { return cfg.messagesPerUser; }
+    static Core* createCore(const Config& cfg, unsigned int id, unsigned int capacity) {
+        return new Core(id, capacity, cfg.antennas);
+    }
+};
+
+template<>
+struct GenerationTraits<5> {
+    typedef Config5G Config;
+    typedef Core5G Core;
+    static constexpr const char* NAME = "5G";
+    static constexpr Channelization CHANNELIZATION = CHANNEL_PER_MHZ;
+    static constexpr bool MULTI_CORE = true;
+    static constexpr bool SPLIT_TRAFFIC = false;
+
+    static const Config& config(const SimulationConfig& sim) { return sim.config5G; }
+    static unsigned int usersPerChannel(const Config& cfg) { return cfg.usersPerMHz; }
+    static unsigned int mimoFactor(const Config& cfg) { return cfg.antennas; }
+    static unsigned int messagesPerUser(const Config& cfg) { return cfg.messagesPerUser; }
+    static Core* createCore(const Config& cfg, unsigned int id, unsigned int capacity) {
+        return new Core(id, capacity, cfg.antennas, true);
+    }
+};
+
+#endif
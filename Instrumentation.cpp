@@ -0,0 +1,141 @@
+// Instrumentation.cpp
+#include "Instrumentation.h"
+
+#ifdef SIM_COUNT_ALLOCATIONS
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace Instrumentation {
+    Total counters[COUNTER_COUNT];
+}
+
+// Every operator new of the process is counted
+static void* countedAllocation(std::size_t size, std::size_t alignment) {
+    Instrumentation::count(COUNTER_ALLOCATIONS, 1);
+    Instrumentation::count(COUNTER_ALLOCATED_BYTES, size);
+
+    void* memory;
+    if (alignment <= alignof(std::max_align_t)) {
+        memory = std::malloc(size ? size : 1);
+    } else {
+        memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocation(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocation(size, (std::size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+#endif
+
+#ifdef SIM_INSTRUMENT
+
+#include "basicIO.h"
+
+extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
+
+#define SYS_CLOCK_GETTIME 228
+#define CLOCK_MONOTONIC 1
+
+namespace Instrumentation {
+    Total phases[PHASE_COUNT];
+}
+
+static const char* PHASE_NAMES[PHASE_COUNT] = {
+    "Capacity analysis",
+    "Device creation",
+    "Channel assignment",
+    "Report formatting",
+    "Output syscalls"
+};
+
+static const char* COUNTER_NAMES[COUNTER_COUNT] = {
+    "Output syscalls",
+    "Bytes written",
+    "Allocations",
+    "Allocated bytes",
+    "Open-channel words scanned"
+};
+
+struct TimeSpec {
+    long seconds;
+    long nanoseconds;
+};
+
+static unsigned long long nowNs() {
+    TimeSpec ts;
+    syscall3(SYS_CLOCK_GETTIME, CLOCK_MONOTONIC, (long)&ts, 0);
+    return (unsigned long long)ts.seconds * 1000000000ull + (unsigned long long)ts.nanoseconds;
+}
+
+// TSC and clock at registration; the ratio at exit converts cycles to time
+static unsigned long long startCycles;
+static unsigned long long startNs;
+
+static void writeNumber(unsigned long long value) {
+    char digits[24];
+    unsigned int len = 0;
+    do {
+        digits[sizeof(digits) - 2 - len++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    digits[sizeof(digits) - 1] = '\0';
+    io.errorstring(digits + sizeof(digits) - 1 - len);
+}
+
+static void writeLabel(const char* label) {
+    io.errorstring("  ");
+    io.errorstring(label);
+    io.errorstring(": ");
+}
+
+static void writeSummary() {
+    const unsigned long long cycles = __rdtsc() - startCycles;
+    const unsigned long long ns = nowNs() - startNs;
+    const double nsPerCycle = (cycles > 0) ? (double)ns / (double)cycles : 0.0;
+
+    io.errorstring("\n--- Instrumentation Summary ---\n");
+    io.errorstring("Phases (calls, microseconds):\n");
+    for (unsigned int p = 0; p < PHASE_COUNT; ++p) {
+        writeLabel(PHASE_NAMES[p]);
+        writeNumber(Instrumentation::phases[p].calls.load(std::memory_order_relaxed));
+        io.errorstring(", ");
+        writeNumber((unsigned long long)(Instrumentation::phases[p].value.load(std::memory_order_relaxed)
+                                         * nsPerCycle / 1000.0));
+        io.errorstring(" us\n");
+    }
+
+    io.errorstring("Counters:\n");
+    for (unsigned int c = 0; c < COUNTER_COUNT; ++c) {
+        writeLabel(COUNTER_NAMES[c]);
+        writeNumber(Instrumentation::counters[c].value.load(std::memory_order_relaxed));
+        io.errorstring("\n");
+    }
+
+    writeLabel("Wall time");
+    writeNumber(ns / 1000);
+    io.errorstring(" us\n");
+}
+
+// Registered after the global BasicIO exists, so the summary is written
+// before it is torn down
+void Instrumentation::reportAtExit() {
+    startCycles = __rdtsc();
+    startNs = nowNs();
+    std::atexit(writeSummary);
+}
+
+#endif
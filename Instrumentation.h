@@ -0,0 +1,110 @@
+// Instrumentation.h
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+// Phase timers and hot-path counters. Built with -DSIM_INSTRUMENT (make
+// profile) they time the phases of every simulation with the TSC, count
+// output syscalls, bytes written, allocations and open-channel words
+// scanned, and print a summary on stderr at exit. Without it every macro
+// expands to nothing.
+//
+//   SIM_TIME_PHASE(phase)      time the rest of the enclosing scope
+//   SIM_COUNT(counter, amount) add to a counter
+//   SIM_REPORT_AT_EXIT()       call once at the start of main
+
+enum InstrumentPhase {
+    PHASE_CAPACITY,         // Capacity analysis
+    PHASE_DEVICES,          // Creating the device pool
+    PHASE_ASSIGNMENT,       // Admitting devices to channels and cores
+    PHASE_REPORT,           // Formatting the report
+    PHASE_OUTPUT,           // write/writev calls (also inside the phase that flushed)
+    PHASE_COUNT
+};
+
+enum InstrumentCounter {
+    COUNTER_SYSCALLS,               // Issued by BasicIO and CharBuffer
+    COUNTER_BYTES_WRITTEN,
+    COUNTER_ALLOCATIONS,
+    COUNTER_ALLOCATED_BYTES,
+    COUNTER_CHANNEL_WORDS_SCANNED,  // 64-channel words searched for an open channel
+    COUNTER_COUNT
+};
+
+// The instrumented build counts allocations too; the benchmarks count
+// them alone, with -DSIM_COUNT_ALLOCATIONS (make bench)
+#if defined(SIM_INSTRUMENT) && !defined(SIM_COUNT_ALLOCATIONS)
+#define SIM_COUNT_ALLOCATIONS
+#endif
+
+#if defined(SIM_INSTRUMENT) || defined(SIM_COUNT_ALLOCATIONS)
+
+#include <atomic>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+namespace Instrumentation {
+    // One cache line per total so threads counting different things do
+    // not slow each other down
+    struct alignas(CACHE_LINE_SIZE) Total {
+        std::atomic<unsigned long long> value;
+        std::atomic<unsigned long long> calls;
+    };
+
+    extern Total counters[COUNTER_COUNT];
+
+    inline void count(InstrumentCounter counter, unsigned long long amount) {
+        counters[counter].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    inline unsigned long long total(InstrumentCounter counter) {
+        return counters[counter].value.load(std::memory_order_relaxed);
+    }
+}
+
+#endif
+
+#ifdef SIM_INSTRUMENT
+
+#include <x86intrin.h>
+
+namespace Instrumentation {
+    extern Total phases[PHASE_COUNT];
+
+    void reportAtExit();
+}
+
+class ScopedPhaseTimer {
+private:
+    InstrumentPhase phase;
+    unsigned long long start;
+
+public:
+    explicit ScopedPhaseTimer(InstrumentPhase timedPhase) : phase(timedPhase), start(__rdtsc()) {}
+
+    ~ScopedPhaseTimer() {
+        Instrumentation::phases[phase].value.fetch_add(__rdtsc() - start, std::memory_order_relaxed);
+        Instrumentation::phases[phase].calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+};
+
+#define SIM_CONCAT_INNER(a, b) a##b
+#define SIM_CONCAT(a, b) SIM_CONCAT_INNER(a, b)
+
+#define SIM_TIME_PHASE(phase) ScopedPhaseTimer SIM_CONCAT(phaseTimer, __LINE__)(phase)
+#define SIM_COUNT(counter, amount) Instrumentation::count(counter, amount)
+#define SIM_REPORT_AT_EXIT() Instrumentation::reportAtExit()
+
+#else
+
+#define SIM_TIME_PHASE(phase) ((void)0)
+#define SIM_COUNT(counter, amount) ((void)0)
+#define SIM_REPORT_AT_EXIT() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,409 @@
+// Network.cpp
+#include "Network.h"
+#include "ThreadPool.h"
+#include "OutputSink.h"
+#include "Instrumentation.h"
+
+// Towers per task when reserving home capacity
+#define HOME_CHUNK_TOWERS 64
+
+struct SpillTransfer {
+    unsigned int target;
+    unsigned int firstDevice;
+    unsigned int count;
+};
+
+static unsigned long long mixBits(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static unsigned int gridWidthFor(unsigned int count) {
+    unsigned int width = 1;
+    while ((unsigned long long)width * width < count) width++;
+    return width;
+}
+
+Network::Network(unsigned int numTowers, const TowerSpec& spec, CellularCore** corePool,
+                 unsigned int numCores, unsigned int users, unsigned int msgsPerUser)
+    : towerCount(numTowers), gridWidth(gridWidthFor(numTowers)), towers(nullptr),
+      cores(corePool), coreCount(numCores), coreFirst(nullptr), devices(nullptr),
+      userCount(users), messagesPerUser(msgsPerUser),
+      homeAdmitted(0), spilled(0), rejected(0) {
+    if (towerCount == 0) {
+        throw "A network needs at least one tower";
+    }
+    
+    devices = new DevicePool(userCount);
+    
+    coreFirst = new unsigned int[towerCount + 1];
+    for (unsigned int t = 0; t <= towerCount; ++t) {
+        coreFirst[t] = (unsigned int)((unsigned long long)t * coreCount / towerCount);
+    }
+    
+    towers = new CellTower*[towerCount];
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        CellularCore* core = (coreCount > 0) ? cores[coreFirst[t]] : nullptr;
+        towers[t] = new CellTower(t + 1, core, devices, spec.bandwidth, spec.channelBandwidth,
+                                  spec.usersPerChannel, spec.antennas);
+    }
+}
+
+Network::~Network() {
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        delete towers[t];
+    }
+    delete[] towers;
+    
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        delete cores[c];
+    }
+    delete[] cores;
+    delete[] coreFirst;
+    delete devices;
+}
+
+// Reserves up to users on the tower's cores without locking and returns
+// how many fit; safe while other towers reserve on the same cores
+unsigned int Network::reserveCores(unsigned int tower, unsigned int users) {
+    if (coreCount == 0) return 0;
+    
+    unsigned int first = coreFirst[tower];
+    unsigned int last = (coreFirst[tower + 1] > first) ? coreFirst[tower + 1] : first + 1;
+    
+    unsigned int reserved = 0;
+    for (unsigned int c = first; c < last && reserved < users; ++c) {
+        reserved += cores[c]->reserveLoad(users - reserved);
+    }
+    return reserved;
+}
+
+// With fewer cores than towers, every tower uses the single core
+// coreFirst[t] and neighbouring towers share it. Each shared core's free
+// capacity is split among its towers before anything is reserved, max-min
+// fairly: every tower gets its demand up to a common level, and the units
+// left over go one each to the lowest-numbered towers still wanting more.
+// The quotas fit, so the concurrent reservations all succeed whatever
+// order they run in. quota holds each tower's demand and is lowered to
+// its share.
+void Network::planCoreQuotas(unsigned int* quota) const {
+    if (coreCount == 0 || coreCount >= towerCount) return;
+    
+    unsigned int first = 0;
+    while (first < towerCount) {
+        unsigned int last = first + 1;
+        while (last < towerCount && coreFirst[last] == coreFirst[first]) last++;
+        
+        if (last - first > 1) {
+            const CellularCore* core = cores[coreFirst[first]];
+            unsigned int free = (core->getCapacity() > core->getCurrentLoad())
+                ? core->getCapacity() - core->getCurrentLoad() : 0;
+            
+            auto fillTo = [&](unsigned int level) {
+                unsigned long long units = 0;
+                for (unsigned int t = first; t < last; ++t) {
+                    units += (quota[t] < level) ? quota[t] : level;
+                }
+                return units;
+            };
+            
+            unsigned int low = 0;
+            unsigned int high = 0;
+            for (unsigned int t = first; t < last; ++t) {
+                if (quota[t] > high) high = quota[t];
+            }
+            while (low < high) {
+                unsigned int mid = low + (high - low + 1) / 2;
+                if (fillTo(mid) <= free) low = mid;
+                else high = mid - 1;
+            }
+            
+            unsigned int leftover = free - (unsigned int)fillTo(low);
+            for (unsigned int t = first; t < last; ++t) {
+                if (quota[t] > low) {
+                    quota[t] = low;
+                    if (leftover > 0) {
+                        quota[t]++;
+                        leftover--;
+                    }
+                }
+            }
+        }
+        first = last;
+    }
+}
+
+unsigned int Network::getNeighbor(unsigned int tower, unsigned int direction) const {
+    static const int dx[NEIGHBOR_COUNT] = { 0, 0, -1, 1, -1, 1, -1, 1 };
+    static const int dy[NEIGHBOR_COUNT] = { -1, 1, 0, 0, -1, -1, 1, 1 };
+    
+    int x = (int)(tower % gridWidth) + dx[direction];
+    int y = (int)(tower / gridWidth) + dy[direction];
+    if (x < 0 || y < 0 || x >= (int)gridWidth) return NO_DEVICE;
+    
+    unsigned int neighbor = (unsigned int)y * gridWidth + (unsigned int)x;
+    return (neighbor < towerCount) ? neighbor : NO_DEVICE;
+}
+
+// Gives every user a home tower, denser towards the middle of the grid,
+// and adds the devices grouped by home tower so each tower's users form
+// one contiguous range [homeStart[t], homeStart[t + 1]) of the pool.
+void Network::placeUsers(unsigned int seed, unsigned int* homeStart) {
+    unsigned int* home = new unsigned int[userCount];
+    
+    for (unsigned int u = 0; u < userCount; ++u) {
+        unsigned long long r1 = mixBits(((unsigned long long)seed << 32) | u);
+        unsigned long long r2 = mixBits(r1);
+        
+        // Sum of two uniforms: a triangular distribution peaking mid-grid
+        unsigned int x = (unsigned int)(((r1 & 0xFFFFFFFFu) % gridWidth + (r1 >> 32) % gridWidth) / 2);
+        unsigned int y = (unsigned int)(((r2 & 0xFFFFFFFFu) % gridWidth + (r2 >> 32) % gridWidth) / 2);
+        unsigned int tower = y * gridWidth + x;
+        while (tower >= towerCount) tower -= gridWidth;
+        home[u] = tower;
+    }
+    
+    for (unsigned int t = 0; t <= towerCount; ++t) {
+        homeStart[t] = 0;
+    }
+    for (unsigned int u = 0; u < userCount; ++u) {
+        homeStart[home[u] + 1]++;
+    }
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        homeStart[t + 1] += homeStart[t];
+    }
+    
+    unsigned int* cursor = new unsigned int[towerCount];
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        cursor[t] = homeStart[t];
+    }
+    unsigned int* order = new unsigned int[userCount];
+    for (unsigned int u = 0; u < userCount; ++u) {
+        order[cursor[home[u]]++] = u;
+    }
+    for (unsigned int i = 0; i < userCount; ++i) {
+        devices->addDevice(order[i] + 1, messagesPerUser);
+    }
+    
+    delete[] order;
+    delete[] cursor;
+    delete[] home;
+}
+
+void Network::admitUsers(unsigned int seed, ThreadPool* pool) {
+    SIM_TIME_PHASE(PHASE_ASSIGNMENT);
+    unsigned int* homeStart = new unsigned int[towerCount + 1];
+    placeUsers(seed, homeStart);
+    
+    // Home users are admitted before any spill. Every tower reserves
+    // concurrently, towers sharing a core included, up to a quota fixed
+    // beforehand, so the outcome does not depend on thread timing.
+    unsigned int* homeCount = new unsigned int[towerCount];
+    unsigned int* planned = new unsigned int[towerCount];
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        unsigned int demand = homeStart[t + 1] - homeStart[t];
+        unsigned int capacity = towers[t]->getTotalCapacity();
+        homeCount[t] = (demand < capacity) ? demand : capacity;
+    }
+    planCoreQuotas(homeCount);
+    
+    auto admitHome = [&](unsigned long long first, unsigned long long last) {
+        for (unsigned long long t = first; t < last; ++t) {
+            unsigned int take = reserveCores((unsigned int)t, homeCount[t]);
+            homeCount[t] = take;
+            planned[t] = take;
+        }
+    };
+    
+    if (pool) {
+        pool->parallelFor(0, towerCount, HOME_CHUNK_TOWERS, admitHome);
+    } else {
+        admitHome(0, towerCount);
+    }
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        homeAdmitted += homeCount[t];
+    }
+    
+    // Overflow is the tail of each home range, offered to the neighbours
+    SpillTransfer* transfers = new SpillTransfer[(unsigned long long)towerCount * NEIGHBOR_COUNT];
+    unsigned int transferCount = 0;
+    unsigned int* incomingStart = new unsigned int[towerCount + 1];
+    for (unsigned int t = 0; t <= towerCount; ++t) {
+        incomingStart[t] = 0;
+    }
+    
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        unsigned int next = homeStart[t] + homeCount[t];
+        unsigned int overflow = homeStart[t + 1] - next;
+        
+        for (unsigned int d = 0; d < NEIGHBOR_COUNT && overflow > 0; ++d) {
+            unsigned int n = getNeighbor(t, d);
+            if (n == NO_DEVICE) continue;
+            
+            unsigned int free = towers[n]->getTotalCapacity() - planned[n];
+            unsigned int take = reserveCores(n, (overflow < free) ? overflow : free);
+            if (take == 0) continue;
+            
+            planned[n] += take;
+            transfers[transferCount].target = n;
+            transfers[transferCount].firstDevice = next;
+            transfers[transferCount].count = take;
+            transferCount++;
+            incomingStart[n + 1]++;
+            
+            next += take;
+            overflow -= take;
+            spilled += take;
+        }
+        rejected += overflow;
+    }
+    
+    // Group transfers by target tower, keeping source order
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        incomingStart[t + 1] += incomingStart[t];
+    }
+    unsigned int* incoming = new unsigned int[transferCount > 0 ? transferCount : 1];
+    unsigned int* cursor = new unsigned int[towerCount];
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        cursor[t] = incomingStart[t];
+    }
+    for (unsigned int i = 0; i < transferCount; ++i) {
+        incoming[cursor[transfers[i].target]++] = i;
+    }
+    
+    // Towers only touch their own channels and devices, so they fill in parallel
+    auto fillTowers = [&](unsigned long long first, unsigned long long last) {
+        for (unsigned long long t = first; t < last; ++t) {
+            CellTower* tower = towers[t];
+            tower->admitDevices(homeStart[t], homeCount[t], pool);
+            for (unsigned int i = incomingStart[t]; i < incomingStart[t + 1]; ++i) {
+                const SpillTransfer& transfer = transfers[incoming[i]];
+                tower->admitDevices(transfer.firstDevice, transfer.count);
+            }
+        }
+    };
+    
+    if (pool) {
+        pool->parallelFor(0, towerCount, 1, fillTowers);
+    } else {
+        fillTowers(0, towerCount);
+    }
+    
+    delete[] cursor;
+    delete[] incoming;
+    delete[] incomingStart;
+    delete[] transfers;
+    delete[] planned;
+    delete[] homeCount;
+    delete[] homeStart;
+}
+
+template<typename Sink>
+void Network::displayNetworkInfo(Sink& out) const {
+    unsigned long long totalLoad = 0;
+    unsigned long long totalCapacity = 0;
+    unsigned int busiest = 0;
+    unsigned int idleTowers = 0;
+    unsigned int fullTowers = 0;
+    
+    for (unsigned int t = 0; t < towerCount; ++t) {
+        unsigned int load = towers[t]->getCurrentLoad();
+        unsigned int capacity = towers[t]->getTotalCapacity();
+        totalLoad += load;
+        totalCapacity += capacity;
+        
+        if (load > towers[busiest]->getCurrentLoad()) busiest = t;
+        if (load == 0) idleTowers++;
+        if (capacity > 0 && load == capacity) fullTowers++;
+    }
+    
+    unsigned long long coreLoad = 0;
+    unsigned long long coreCapacity = 0;
+    unsigned long long contention = 0;
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        coreLoad += cores[c]->getCurrentLoad();
+        coreCapacity += cores[c]->getCapacity();
+        contention += cores[c]->getContention();
+    }
+    
+    out.append("\n--- Network Topology ---");
+    out.newline();
+    out.append("Towers: ");
+    out.append(towerCount);
+    out.append(" (");
+    out.append(gridWidth);
+    out.append(" x ");
+    out.append((towerCount + gridWidth - 1) / gridWidth);
+    out.append(" grid)");
+    out.newline();
+    out.append("Capacity per Tower: ");
+    out.append(towers[0]->getTotalCapacity());
+    out.append(" users");
+    out.newline();
+    out.append("Shared Core Pool: ");
+    out.append(coreCount);
+    out.append(" cores x ");
+    out.append((coreCount > 0) ? cores[0]->getCapacity() : 0u);
+    out.append(" users");
+    out.newline();
+    if (coreCount > 0 && cores[0]) {
+        out.append("Cellular Core: ");
+        out.append(cores[0]->getProtocolName());
+        out.newline();
+    }
+    
+    out.append("\n--- Network Admission ---");
+    out.newline();
+    out.append("Requested: ");
+    out.append(userCount);
+    out.append(" users");
+    out.newline();
+    out.append("Admitted at Home Tower: ");
+    out.append(homeAdmitted);
+    out.append(" users");
+    out.newline();
+    out.append("Spilled to Neighbors: ");
+    out.append(spilled);
+    out.append(" users");
+    out.newline();
+    out.append("Rejected: ");
+    out.append(rejected);
+    out.append(" users");
+    out.newline();
+    
+    out.append("\n--- Network Load ---");
+    out.newline();
+    // Totals can exceed 32 bits, so capacities are shown as percentages
+    out.append("Active Users: ");
+    out.append((unsigned int)totalLoad);
+    out.append(" (");
+    out.append((unsigned int)(totalCapacity > 0 ? totalLoad * 100 / totalCapacity : 0));
+    out.append("% of network capacity)");
+    out.newline();
+    out.append("Core Pool Load: ");
+    out.append((unsigned int)coreLoad);
+    out.append(" users (");
+    out.append((unsigned int)(coreCapacity > 0 ? coreLoad * 100 / coreCapacity : 0));
+    out.append("% of pool capacity)");
+    out.newline();
+    out.append("Core Reservation Retries: ");
+    out.append((unsigned int)contention);
+    out.newline();
+    out.append("Full Towers: ");
+    out.append(fullTowers);
+    out.append(", Idle Towers: ");
+    out.append(idleTowers);
+    out.newline();
+    out.append("Busiest Tower: ");
+    out.append(towers[busiest]->getTowerId());
+    out.append(" (");
+    out.append(towers[busiest]->getCurrentLoad());
+    out.append(" users)");
+    out.newline();
+}
+
+template void Network::displayNetworkInfo<DirectSink>(DirectSink&) const;
+template void Network::displayNetworkInfo<CharBuffer>(CharBuffer&) const;
+template void Network::displayNetworkInfo<NullSink>(NullSink&) const;
@@ -0,0 +1,82 @@
+// Network.h
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include "CellTower.h"
+#include "DevicePool.h"
+
+class ThreadPool;
+
+// Radio parameters shared by every tower of one generation
+struct TowerSpec {
+    unsigned int bandwidth;
+    unsigned int channelBandwidth;
+    unsigned int usersPerChannel;
+    unsigned int antennas;
+};
+
+// Users rejected by their home tower are offered to these grid neighbours,
+// in this order: N, S, W, E, then the diagonals
+#define NEIGHBOR_COUNT 8
+
+// A region of towers laid out on a square grid, all backed by one shared
+// pool of cores. Every user has a home tower; overflow spills to the
+// neighbours of that tower before it is rejected.
+//
+// Home admission reserves core capacity from all towers in parallel with
+// lock-free updates. Towers sharing a core split it into fair quotas first,
+// so results do not depend on thread timing. Spill-over is planned
+// sequentially over per-tower counts, and the per-user channel assignment
+// then runs one task per tower across the thread pool.
+class Network {
+private:
+    unsigned int towerCount;
+    unsigned int gridWidth;
+    CellTower** towers;
+    
+    // Tower t is served by cores [coreFirst[t], coreFirst[t + 1]) when it
+    // has its own, or shares core coreFirst[t] with its neighbours
+    CellularCore** cores;
+    unsigned int coreCount;
+    unsigned int* coreFirst;
+    
+    DevicePool* devices;
+    unsigned int userCount;
+    unsigned int messagesPerUser;
+    
+    unsigned int homeAdmitted;
+    unsigned int spilled;
+    unsigned int rejected;
+    
+    void placeUsers(unsigned int seed, unsigned int* homeStart);
+    unsigned int reserveCores(unsigned int tower, unsigned int users);
+    void planCoreQuotas(unsigned int* quota) const;
+    unsigned int getNeighbor(unsigned int tower, unsigned int direction) const;
+    
+public:
+    // Takes ownership of the cores array and every core in it
+    Network(unsigned int numTowers, const TowerSpec& spec, CellularCore** corePool,
+            unsigned int numCores, unsigned int users, unsigned int msgsPerUser);
+    ~Network();
+    
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+    
+    void admitUsers(unsigned int seed, ThreadPool* pool = nullptr);
+    
+    unsigned int getTowerCount() const { return towerCount; }
+    unsigned int getGridWidth() const { return gridWidth; }
+    unsigned int getCoreCount() const { return coreCount; }
+    unsigned int getUserCount() const { return userCount; }
+    unsigned int getHomeAdmitted() const { return homeAdmitted; }
+    unsigned int getSpilled() const { return spilled; }
+    unsigned int getRejected() const { return rejected; }
+    CellTower* getTower(unsigned int index) const { return towers[index]; }
+    CellularCore* getCore(unsigned int index) const { return cores[index]; }
+    DevicePool* getDevicePool() const { return devices; }
+    
+    template<typename Sink>
+    void displayNetworkInfo(Sink& out) const;
+};
+
+#endif
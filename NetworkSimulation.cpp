@@ -0,0 +1,455 @@
+// NetworkSimulation.cpp
+#include "NetworkSimulation.h"
+#include "CellTower.h"
+#include "CellularCore.h"
+#include "Capacity.h"
+#include "GenerationTraits.h"
+#include "Network.h"
+#include "DynamicSimulation.h"
+#include "ThreadPool.h"
+#include "Instrumentation.h"
+#include "ResultEncoder.h"
+
+DevicePool* createUserDevices(unsigned int count, unsigned int messagesPerUser) {
+    SIM_TIME_PHASE(PHASE_DEVICES);
+    DevicePool* devices = new DevicePool(count);
+    devices->addSequentialDevices(count, messagesPerUser);
+    return devices;
+}
+
+// Admits devices 0..count-1 through the core pool. Runs of devices the
+// pool accepts go to the tower in bulk, so an empty tower is still filled
+// in parallel chunks.
+static void admitThroughCores(CellTower* tower, CorePool* cores, unsigned int count,
+                              ThreadPool* pool) {
+    DevicePool* devices = tower->getDevicePool();
+    unsigned int runStart = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        if (cores->admit(devices->getDeviceId(i)) == NO_CORE) {
+            tower->admitDevices(runStart, i - runStart, pool);
+            runStart = i + 1;
+        }
+    }
+    tower->admitDevices(runStart, count - runStart, pool);
+}
+
+// Tower, core and first-channel sections of the report, and the result
+// record; Tower is a CellTower or a LazyTower
+template<unsigned int Generation, typename Tower, typename Sink>
+static void reportTower(const Tower* tower, const CorePool* corePool, const CapacityResult& cap,
+                        Sink& out, const EngineOptions& options) {
+    {
+        SIM_TIME_PHASE(PHASE_REPORT);
+        tower->displayTowerInfo(out);
+        out.append("Required Cores: ");
+        out.append(cap.coresNeeded);
+        out.newline();
+        
+        if (GenerationTraits<Generation>::MULTI_CORE) {
+            corePool->displayUtilization(out, options.verbosity >= VERBOSITY_CHANNEL);
+        }
+        if (options.verbosity >= VERBOSITY_CHANNEL) {
+            tower->displayFirstChannelUsers(out, options.verbosity >= VERBOSITY_DEVICE);
+        }
+    }
+    
+    if (options.results && options.records) {
+        options.results->encode(*options.records, Generation, 0, cap, tower);
+    } else if (options.results) {
+        options.results->record(Generation, 0, cap, tower);
+    }
+}
+
+// Channels, frequency limit and their derivation
+template<unsigned int Generation, typename Sink>
+static void displayChannelization(const typename GenerationTraits<Generation>::Config& cfg,
+                                  const CapacityResult& cap, Sink& out) {
+    typedef GenerationTraits<Generation> Traits;
+    
+    if (Traits::CHANNELIZATION == CHANNEL_PER_MHZ) {
+        out.append("Bandwidth in MHz: ");
+        out.append(cap.numChannels);
+        out.newline();
+        
+        out.append("Base Users: ");
+        out.append(cap.baseUsers);
+        out.append(" (");
+        out.append(cap.numChannels);
+        out.append(" MHz x ");
+        out.append(Traits::usersPerChannel(cfg));
+        out.append(" users/MHz)");
+        out.newline();
+        
+        out.append("Massive MIMO Gain: ");
+        out.append(cap.frequencyLimit);
+        out.append(" users (");
+        out.append(cap.baseUsers);
+        out.append(" x ");
+        out.append(Traits::mimoFactor(cfg));
+        out.append(" antennas)");
+        out.newline();
+    } else {
+        out.append("Channels: ");
+        out.append(cap.numChannels);
+        out.append(" (");
+        out.append(cfg.bandwidth);
+        out.append(" / ");
+        out.append(cfg.channelBw);
+        out.append(")");
+        out.newline();
+    }
+    
+    if (Traits::CHANNELIZATION == CHANNEL_OFDM) {
+        out.append("Base Users per Channel: ");
+        out.append(Traits::usersPerChannel(cfg));
+        out.newline();
+        
+        out.append("Users per Channel with MIMO: ");
+        out.append(cap.usersPerChannel);
+        out.append(" (");
+        out.append(Traits::usersPerChannel(cfg));
+        out.append(" x ");
+        out.append(Traits::mimoFactor(cfg));
+        out.append(" antennas)");
+        out.newline();
+    }
+    
+    if (Traits::MULTI_CORE) {
+        out.append("Total Frequency Limit: ");
+        out.append(cap.frequencyLimit);
+        out.append(" users");
+        out.newline();
+    } else {
+        out.append("Frequency Limit: ");
+        out.append(cap.frequencyLimit);
+        out.append(" users (");
+        out.append(cap.numChannels);
+        out.append(" x ");
+        out.append(Traits::usersPerChannel(cfg));
+        out.append(")");
+        out.newline();
+    }
+}
+
+template<unsigned int Generation, typename Sink>
+void simulateGeneration(const typename GenerationTraits<Generation>::Config& cfg,
+                        unsigned int coreCapacity, Sink& out, const EngineOptions& options) {
+    typedef GenerationTraits<Generation> Traits;
+    const CapacityResult cap = computeCapacity<Generation>(cfg, coreCapacity);
+    
+    out.append("\n\n===========================================");
+    out.newline();
+    out.append("          ");
+    out.append(Traits::NAME);
+    out.append(" NETWORK SIMULATION");
+    out.newline();
+    out.append("===========================================");
+    out.newline();
+    
+    out.append("\n--- Network Configuration ---");
+    out.newline();
+    out.append("Bandwidth: ");
+    out.append(cfg.bandwidth);
+    out.append((Traits::CHANNELIZATION == CHANNEL_PER_MHZ) ? " kHz (10 MHz @ 1800 MHz)" : " kHz");
+    out.newline();
+    out.append("Channel Bandwidth: ");
+    out.append(cfg.channelBw);
+    out.append((Traits::CHANNELIZATION == CHANNEL_OFDM) ? " kHz (OFDM)" : " kHz");
+    out.newline();
+    out.append((Traits::CHANNELIZATION == CHANNEL_PER_MHZ) ? "Users per MHz: " : "Users per Channel: ");
+    out.append(Traits::usersPerChannel(cfg));
+    if (Traits::CHANNELIZATION == CHANNEL_TDMA) out.append(" (TDMA)");
+    if (Traits::CHANNELIZATION == CHANNEL_CDMA) out.append(" (CDMA)");
+    out.newline();
+    
+    if (Traits::CHANNELIZATION == CHANNEL_OFDM || Traits::CHANNELIZATION == CHANNEL_PER_MHZ) {
+        out.append((Traits::CHANNELIZATION == CHANNEL_PER_MHZ) ? "Massive MIMO Antennas: " : "MIMO Antennas: ");
+        out.append(Traits::mimoFactor(cfg));
+        out.append(" (Parallel)");
+        out.newline();
+    }
+    
+    out.append("Messages per User: ");
+    out.append(cap.messagesPerUser);
+    if constexpr (Traits::SPLIT_TRAFFIC) {
+        out.append(" (");
+        out.append(cfg.dataMessages);
+        out.append(" data + ");
+        out.append(cfg.voiceMessages);
+        out.append(" voice)");
+    }
+    out.newline();
+    
+    out.append("Overhead: ");
+    out.append(cfg.overhead);
+    out.append("%");
+    out.newline();
+    out.append("Core Capacity: ");
+    out.append(coreCapacity);
+    out.append(" messages");
+    out.newline();
+    
+    out.append("\n--- Capacity Analysis ---");
+    out.newline();
+    
+    displayChannelization<Generation>(cfg, cap, out);
+    
+    if (Traits::MULTI_CORE) {
+        out.append("\nCore Calculation:");
+        out.newline();
+        
+        out.append("  Messages per user with overhead: ");
+        out.append(cap.effectiveMsgs);
+        out.newline();
+        
+        out.append("  Single core limit: ");
+        out.append(cap.coreLimit);
+        out.append(" users");
+        out.newline();
+        
+        out.append("  Required cores: ");
+        out.append(cap.coresNeeded);
+        out.newline();
+        
+        out.append("  Multi-core limit: ");
+        out.append(cap.multiCoreLimit);
+        out.append(" users");
+        out.newline();
+        
+        out.append("\nTower Capacity: ");
+    } else {
+        out.append("Core Limit: ");
+        out.append(cap.coreLimit);
+        out.append(" users (");
+        out.append(coreCapacity);
+        out.append(" / ");
+        out.append(cap.effectiveMsgs);
+        out.append(")");
+        out.newline();
+        
+        out.append("Tower Capacity: ");
+    }
+    out.append(cap.towerCapacity);
+    out.append(" users [LIMITED BY: ");
+    out.append((cap.towerCapacity == cap.frequencyLimit) ? "Frequency" : "Core");
+    out.append("]");
+    out.newline();
+    
+    out.append("\n--- Connection Request Processing ---");
+    out.newline();
+    out.append("Requested: ");
+    out.append(cfg.users);
+    out.append(" users");
+    out.newline();
+    
+    out.append("Accepted: ");
+    out.append(cap.accepted);
+    out.append(" users");
+    out.newline();
+    out.append("Rejected: ");
+    out.append(cap.rejected);
+    out.append(" users");
+    out.newline();
+    
+    if (cap.accepted == cap.towerCapacity && cap.rejected > 0) {
+        out.append("Status: Tower reached maximum capacity");
+        out.newline();
+    }
+    
+    // A single core is sized to the whole tower; multiple cores each take
+    // their share through the core pool
+    const unsigned int coreCount = cap.coresNeeded;
+    const unsigned int coreSize = Traits::MULTI_CORE ? cap.coreLimit : cap.towerCapacity;
+    CellularCore** cores = new CellularCore*[coreCount];
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        cores[c] = Traits::createCore(cfg, c + 1, coreSize);
+    }
+    CorePool* corePool = new CorePool(cores, coreCount, options.corePolicy);
+    CellularCore* core = (coreCount > 0) ? corePool->getCore(0) : nullptr;
+    
+    // Least loaded refuses users only once every core is full, so the tower
+    // still gets devices 1..n in order and a LazyTower can stand in for the
+    // device pool; the other policies refuse users out of order
+    const bool lazy = options.placement == PLACEMENT_LAZY &&
+                      (!Traits::MULTI_CORE || options.corePolicy == CORE_LEAST_LOADED);
+    
+    if (lazy) {
+        LazyTower tower(1, core, cfg.bandwidth, cfg.channelBw, Traits::usersPerChannel(cfg),
+                        Traits::mimoFactor(cfg), options.antennaPolicy);
+        {
+            SIM_TIME_PHASE(PHASE_ASSIGNMENT);
+            if (Traits::MULTI_CORE) {
+                tower.admitDevices(corePool->admitLeastLoaded(cap.accepted));
+            } else {
+                tower.admitDevices(cap.accepted);
+            }
+        }
+        reportTower<Generation>(&tower, corePool, cap, out, options);
+        delete corePool;
+        return;
+    }
+    
+    DevicePool* devices = createUserDevices(cap.accepted, cap.messagesPerUser);
+    CellTower* tower = new CellTower(1, core, devices, cfg.bandwidth, cfg.channelBw,
+                                     Traits::usersPerChannel(cfg), Traits::mimoFactor(cfg),
+                                     options.antennaPolicy);
+    
+    {
+        SIM_TIME_PHASE(PHASE_ASSIGNMENT);
+        if (Traits::MULTI_CORE) {
+            admitThroughCores(tower, corePool, cap.accepted, options.pool);
+        } else {
+            tower->admitDevices(0, cap.accepted, options.pool);
+        }
+    }
+    
+    reportTower<Generation>(tower, corePool, cap, out, options);
+    
+    delete tower;
+    delete devices;
+    delete corePool;
+}
+
+// Seed for home-tower placement and traffic; fixed so runs are reproducible
+#define SIMULATION_SEED 2024
+
+// Capacity analysis, tower parameters and demand of one generation
+template<unsigned int Generation>
+static CapacityResult describe(const SimulationConfig& config, TowerSpec& spec, unsigned int& users) {
+    typedef GenerationTraits<Generation> Traits;
+    const typename Traits::Config& cfg = Traits::config(config);
+    spec = { cfg.bandwidth, cfg.channelBw, Traits::usersPerChannel(cfg), Traits::mimoFactor(cfg) };
+    users = cfg.users;
+    return computeCapacity<Generation>(cfg, config.coreCapacity);
+}
+
+static CapacityResult describeGeneration(unsigned int generation, const SimulationConfig& config,
+                                         TowerSpec& spec, unsigned int& users) {
+    switch (generation) {
+        case 2: return describe<2>(config, spec, users);
+        case 3: return describe<3>(config, spec, users);
+        case 4: return describe<4>(config, spec, users);
+        case 5: return describe<5>(config, spec, users);
+        default:
+            throw "Unknown network generation";
+    }
+}
+
+// Core capacity is counted in users, as for the single-tower cores
+static CellularCore* createCore(unsigned int generation, const SimulationConfig& config,
+                                unsigned int id, unsigned int capacity) {
+    switch (generation) {
+        case 2: return GenerationTraits<2>::createCore(config.config2G, id, capacity);
+        case 3: return GenerationTraits<3>::createCore(config.config3G, id, capacity);
+        case 4: return GenerationTraits<4>::createCore(config.config4G, id, capacity);
+        default: return GenerationTraits<5>::createCore(config.config5G, id, capacity);
+    }
+}
+
+template<typename Sink>
+void simulateNetwork(unsigned int generation, const SimulationConfig& config,
+                     unsigned int towerCount, unsigned int coreCount, Sink& out,
+                     const EngineOptions& options) {
+    TowerSpec spec;
+    unsigned int users = 0;
+    const CapacityResult cap = describeGeneration(generation, config, spec, users);
+    
+    if (coreCount == 0) {
+        coreCount = ((cap.coresNeeded > 0) ? cap.coresNeeded : 1) * towerCount;
+    }
+    
+    CellularCore** cores = new CellularCore*[coreCount];
+    for (unsigned int c = 0; c < coreCount; ++c) {
+        cores[c] = createCore(generation, config, c + 1, cap.coreLimit);
+    }
+    
+    out.append("\n\n===========================================");
+    out.newline();
+    out.append("          ");
+    out.append(generation);
+    out.append("G MULTI-TOWER NETWORK");
+    out.newline();
+    out.append("===========================================");
+    out.newline();
+    
+    Network* network = new Network(towerCount, spec, cores, coreCount, users, cap.messagesPerUser);
+    network->admitUsers(SIMULATION_SEED, options.pool);
+    network->displayNetworkInfo(out);
+    
+    delete network;
+}
+
+template<typename Sink>
+void simulateDynamic(unsigned int generation, const SimulationConfig& config,
+                     unsigned int seconds, Sink& out) {
+    TowerSpec spec;
+    unsigned int users = 0;
+    const CapacityResult cap = describeGeneration(generation, config, spec, users);
+    
+    out.append("\n\n===========================================");
+    out.newline();
+    out.append("          ");
+    out.append(generation);
+    out.append("G DYNAMIC SIMULATION");
+    out.newline();
+    out.append("===========================================");
+    out.newline();
+    out.append("Arrival Rate: ");
+    out.append(config.dynamic.arrivalRate);
+    out.append(" sessions/s, Mean Session: ");
+    out.append(config.dynamic.sessionMs);
+    out.append(" ms");
+    out.newline();
+    
+    // The configured users are the subscriber population drawing sessions
+    DevicePool* devices = createUserDevices(users, cap.messagesPerUser);
+    CellularCore* core = createCore(generation, config, 1, cap.towerCapacity);
+    CellTower* tower = new CellTower(1, core, devices, spec.bandwidth, spec.channelBandwidth,
+                                     spec.usersPerChannel, spec.antennas);
+    
+    DynamicSimulation* simulation = new DynamicSimulation(tower, core, cap.towerCapacity,
+                                                          config.dynamic, seconds, SIMULATION_SEED);
+    simulation->run(out);
+    
+    delete simulation;
+    delete tower;
+    delete devices;
+    delete core;
+}
+
+template void simulateGeneration<2, DirectSink>(const Config2G&, unsigned int, DirectSink&,
+                                                const EngineOptions&);
+template void simulateGeneration<2, CharBuffer>(const Config2G&, unsigned int, CharBuffer&,
+                                                const EngineOptions&);
+template void simulateGeneration<2, NullSink>(const Config2G&, unsigned int, NullSink&,
+                                              const EngineOptions&);
+template void simulateGeneration<3, DirectSink>(const Config3G&, unsigned int, DirectSink&,
+                                                const EngineOptions&);
+template void simulateGeneration<3, CharBuffer>(const Config3G&, unsigned int, CharBuffer&,
+                                                const EngineOptions&);
+template void simulateGeneration<3, NullSink>(const Config3G&, unsigned int, NullSink&,
+                                              const EngineOptions&);
+template void simulateGeneration<4, DirectSink>(const Config4G&, unsigned int, DirectSink&,
+                                                const EngineOptions&);
+template void simulateGeneration<4, CharBuffer>(const Config4G&, unsigned int, CharBuffer&,
+                                                const EngineOptions&);
+template void simulateGeneration<4, NullSink>(const Config4G&, unsigned int, NullSink&,
+                                              const EngineOptions&);
+template void simulateGeneration<5, DirectSink>(const Config5G&, unsigned int, DirectSink&,
+                                                const EngineOptions&);
+template void simulateGeneration<5, CharBuffer>(const Config5G&, unsigned int, CharBuffer&,
+                                                const EngineOptions&);
+template void simulateGeneration<5, NullSink>(const Config5G&, unsigned int, NullSink&,
+                                              const EngineOptions&);
+template void simulateNetwork<DirectSink>(unsigned int, const SimulationConfig&, unsigned int,
+                                          unsigned int, DirectSink&, const EngineOptions&);
+template void simulateNetwork<CharBuffer>(unsigned int, const SimulationConfig&, unsigned int,
+                                          unsigned int, CharBuffer&, const EngineOptions&);
+template void simulateNetwork<NullSink>(unsigned int, const SimulationConfig&, unsigned int,
+                                        unsigned int, NullSink&, const EngineOptions&);
+template void simulateDynamic<DirectSink>(unsigned int, const SimulationConfig&, unsigned int,
+                                          DirectSink&);
+template void simulateDynamic<CharBuffer>(unsigned int, const SimulationConfig&, unsigned int,
+                                          CharBuffer&);
+template void simulateDynamic<NullSink>(unsigned int, const SimulationConfig&, unsigned int,
+                                        NullSink&);
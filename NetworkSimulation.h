@@ -0,0 +1,57 @@
+// NetworkSimulation.h
+#ifndef NETWORKSIMULATION_H
+#define NETWORKSIMULATION_H
+
+#include "DevicePool.h"
+#include "OutputSink.h"
+#include "CorePool.h"
+#include "CellTower.h"
+#include "GenerationTraits.h"
+
+class ThreadPool;
+class ResultEncoder;
+
+// Engine settings shared by every simulation function
+struct EngineOptions {
+    ThreadPool* pool;           // Channel assignment is split across it when set
+    CorePolicy corePolicy;      // How 4G/5G users are spread over the cores
+    AntennaPolicy antennaPolicy; // How each channel spreads users over its antennas
+    ResultEncoder* results;     // Receives one record per simulation when set
+    CharBuffer* records;        // When set, records are encoded here instead, for
+                                // the caller to write in order
+    Verbosity verbosity;        // Sections of the single-tower report
+    DevicePlacement placement;  // Single-tower runs may skip materializing devices
+    
+    EngineOptions()
+        : pool(nullptr), corePolicy(CORE_LEAST_LOADED), antennaPolicy(ANTENNA_ROUND_ROBIN),
+          results(nullptr), records(nullptr), verbosity(VERBOSITY_DEVICE),
+          placement(PLACEMENT_MATERIALIZED) {}
+};
+
+DevicePool* createUserDevices(unsigned int count, unsigned int messagesPerUser);
+
+// One simulation engine for every generation, specialized at compile time
+// through GenerationTraits and parameterized on the output sink
+// (DirectSink, CharBuffer or NullSink). Interactive, threaded and benchmark
+// runs all go through the same code. Instantiated for 2G - 5G.
+template<unsigned int Generation, typename Sink>
+void simulateGeneration(const typename GenerationTraits<Generation>::Config& cfg,
+                        unsigned int coreCapacity, Sink& out,
+                        const EngineOptions& options = EngineOptions());
+
+// Runs one generation (2-5) over a grid of towers that share a core pool.
+// The config's user count is the demand for the whole region; coreCount 0
+// provisions the cores a single tower needs for every tower.
+template<typename Sink>
+void simulateNetwork(unsigned int generation, const SimulationConfig& config,
+                     unsigned int towerCount, unsigned int coreCount, Sink& out,
+                     const EngineOptions& options = EngineOptions());
+
+// Runs one generation's tower over time with Poisson session arrivals and
+// exponential session lengths (see DynamicConfig), printing utilization
+// once per tick. The config's user count is the subscriber population.
+template<typename Sink>
+void simulateDynamic(unsigned int generation, const SimulationConfig& config,
+                     unsigned int seconds, Sink& out);
+
+#endif
@@ -0,0 +1,46 @@
+// OutputSink.h
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include "basicIO.h"
+#include "CharBuffer.h"
+#include <mutex>
+
+// How much of a report is produced. Lower levels skip the formatting of
+// the omitted sections entirely, not just their bytes.
+enum Verbosity {
+    VERBOSITY_SUMMARY,  // Configuration, capacity, admission and aggregate load
+    VERBOSITY_CHANNEL,  // + per-core load and the first channel's user count
+    VERBOSITY_DEVICE    // + every device ID of the first channel
+};
+
+// Output sinks accepted by the simulation engine. Every sink provides
+// append(const char*), append(int), append(unsigned int) and newline().
+// CharBuffer is used directly as the buffered sink.
+
+// Writes straight to stdout through BasicIO. Holds the output lock for its
+// lifetime so a report from one simulation is never interleaved with another.
+class DirectSink {
+private:
+    static inline std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock;
+    
+public:
+    DirectSink() : lock(outputMutex) {}
+    
+    void append(const char* str) { io.outputstring(str); }
+    void append(int num) { io.outputint(num); }
+    void append(unsigned int num) { io.outputint((int)num); }
+    void newline() { io.terminate(); }
+};
+
+// Discards everything; formatting work is compiled away entirely
+class NullSink {
+public:
+    void append(const char*) {}
+    void append(int) {}
+    void append(unsigned int) {}
+    void newline() {}
+};
+
+#endif
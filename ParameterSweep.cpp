@@ -0,0 +1,239 @@
+// ParameterSweep.cpp
+#include "ParameterSweep.h"
+#include "CapacityBatch.h"
+#include "basicIO.h"
+
+#define STDOUT 1
+#define SWEEP_BLOCK_POINTS 65536
+#define SWEEP_CHUNK_POINTS 4096
+
+ParameterSweep::ParameterSweep(const SimulationConfig& baseConfig, unsigned int generationMask)
+    : base(baseConfig), generations(generationMask), axisCount(0), pointCount(1), results(nullptr) {}
+
+static unsigned int parseNumber(const char*& p) {
+    if (*p < '0' || *p > '9') {
+        throw "Invalid --sweep range (expected KEY=start:end[:step])";
+    }
+    unsigned long value = 0;
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        if (value > 0xFFFFFFFFul) {
+            throw "Number out of range in --sweep";
+        }
+        p++;
+    }
+    return (unsigned int)value;
+}
+
+// spec is KEY=value, KEY=start:end or KEY=start:end:step
+void ParameterSweep::addAxis(const char* spec) {
+    if (axisCount == MAX_SWEEP_AXES) {
+        throw "Too many --sweep axes";
+    }
+    
+    const char* equals = spec;
+    while (*equals && *equals != '=') equals++;
+    if (*equals != '=') {
+        throw "Invalid --sweep range (expected KEY=start:end[:step])";
+    }
+    
+    SweepAxis& axis = axes[axisCount];
+    axis.name = spec;
+    axis.nameLength = (unsigned int)(equals - spec);
+    
+    SimulationConfig probe = base;
+    unsigned int* field = ConfigParser::findField(probe, spec, axis.nameLength);
+    if (!field) {
+        throw "Unknown configuration key in --sweep";
+    }
+    axis.offset = (unsigned int)((char*)field - (char*)&probe);
+    
+    const char* p = equals + 1;
+    unsigned int start = parseNumber(p);
+    unsigned int end = start;
+    unsigned int step = 1;
+    if (*p == ':') {
+        p++;
+        end = parseNumber(p);
+        if (*p == ':') {
+            p++;
+            step = parseNumber(p);
+        }
+    }
+    if (*p != '\0' || end < start || step == 0) {
+        throw "Invalid --sweep range (expected KEY=start:end[:step])";
+    }
+    
+    axis.start = start;
+    axis.step = step;
+    axis.count = (end - start) / step + 1;
+    
+    if (pointCount > 0xFFFFFFFFFFFFull / axis.count) {
+        throw "Sweep has too many points";
+    }
+    pointCount *= axis.count;
+    axisCount++;
+}
+
+void ParameterSweep::writeHeader(CharBuffer& out) const {
+    out.append("point");
+    for (unsigned int a = 0; a < axisCount; ++a) {
+        out.append(",");
+        out.append(axes[a].name, axes[a].nameLength);
+    }
+    
+    const char* names[4] = {"2G", "3G", "4G", "5G"};
+    for (unsigned int g = 0; g < 4; ++g) {
+        if (!(generations & (1u << g))) continue;
+        out.append(",");
+        out.append(names[g]);
+        out.append("_capacity,");
+        out.append(names[g]);
+        out.append("_accepted,");
+        out.append(names[g]);
+        out.append("_rejected,");
+        out.append(names[g]);
+        out.append("_cores");
+    }
+    out.newline();
+}
+
+static void appendResult(CharBuffer& out, const CapacityResult& r) {
+    out.append(",");
+    out.append(r.towerCapacity);
+    out.append(",");
+    out.append(r.accepted);
+    out.append(",");
+    out.append(r.rejected);
+    out.append(",");
+    out.append(r.coresNeeded);
+}
+
+// Sets config to the given point and its odometer digits
+void ParameterSweep::decodePoint(unsigned long long point, unsigned int* digits,
+                                 SimulationConfig& config) const {
+    unsigned long long rest = point;
+    for (int a = (int)axisCount - 1; a >= 0; --a) {
+        digits[a] = (unsigned int)(rest % axes[a].count);
+        rest /= axes[a].count;
+    }
+    
+    config = base;
+    for (unsigned int a = 0; a < axisCount; ++a) {
+        *(unsigned int*)((char*)&config + axes[a].offset) = axes[a].start + digits[a] * axes[a].step;
+    }
+}
+
+// Moves config on to the next point; the last axis varies fastest
+void ParameterSweep::nextPoint(unsigned int* digits, SimulationConfig& config) const {
+    for (int a = (int)axisCount - 1; a >= 0; --a) {
+        unsigned int* field = (unsigned int*)((char*)&config + axes[a].offset);
+        if (++digits[a] < axes[a].count) {
+            *field += axes[a].step;
+            return;
+        }
+        digits[a] = 0;
+        *field = axes[a].start;
+    }
+}
+
+// Gathers the points of the range into one batch per generation (columns
+// of config fields), analyses each batch with the vector kernels and then
+// writes the rows (and the records, when records is set)
+void ParameterSweep::evaluateRange(unsigned long long first, unsigned long long last,
+                                   CharBuffer& out, CharBuffer* records) const {
+    if (first >= last) return;
+    
+    const unsigned int count = (unsigned int)(last - first);
+    unsigned int slot[4];
+    unsigned int slots = 0;
+    for (unsigned int g = 0; g < 4; ++g) {
+        slot[g] = (generations & (1u << g)) ? slots++ : 0;
+    }
+    if (slots == 0) slots = 1;
+    CapacityBatch batch(count * slots);
+    
+    unsigned int digits[MAX_SWEEP_AXES];
+    SimulationConfig config;
+    decodePoint(first, digits, config);
+    for (unsigned int i = 0; i < count; ++i) {
+        if (generations & RUN_2G) batch.setPoint(slot[0] * count + i, capacityInput<2>(config.config2G, config.coreCapacity));
+        if (generations & RUN_3G) batch.setPoint(slot[1] * count + i, capacityInput<3>(config.config3G, config.coreCapacity));
+        if (generations & RUN_4G) batch.setPoint(slot[2] * count + i, capacityInput<4>(config.config4G, config.coreCapacity));
+        if (generations & RUN_5G) batch.setPoint(slot[3] * count + i, capacityInput<5>(config.config5G, config.coreCapacity));
+        nextPoint(digits, config);
+    }
+    
+    if (generations & RUN_2G) batch.compute<2>(slot[0] * count, count);
+    if (generations & RUN_3G) batch.compute<3>(slot[1] * count, count);
+    if (generations & RUN_4G) batch.compute<4>(slot[2] * count, count);
+    if (generations & RUN_5G) batch.compute<5>(slot[3] * count, count);
+    
+    decodePoint(first, digits, config);
+    for (unsigned int i = 0; i < count; ++i) {
+        char number[24];
+        unsigned int len = 0;
+        unsigned long long value = first + i;
+        do {
+            number[sizeof(number) - 1 - len++] = '0' + (char)(value % 10);
+            value /= 10;
+        } while (value > 0);
+        out.append(number + sizeof(number) - len, len);
+        
+        for (unsigned int a = 0; a < axisCount; ++a) {
+            out.append(",");
+            out.append(*(const unsigned int*)((const char*)&config + axes[a].offset));
+        }
+        
+        for (unsigned int g = 0; g < 4; ++g) {
+            if (!(generations & (1u << g))) continue;
+            const CapacityResult r = batch.getResult(slot[g] * count + i);
+            appendResult(out, r);
+            if (records) {
+                results->encode(*records, g + 2, first + i, r);
+            }
+        }
+        out.newline();
+        
+        nextPoint(digits, config);
+    }
+}
+
+void ParameterSweep::run(ThreadPool& pool) const {
+    CharBuffer header;
+    writeHeader(header);
+    io.flush();
+    header.writeTo(STDOUT);
+    
+    CharBuffer* buffers = new CharBuffer[SWEEP_BLOCK_POINTS / SWEEP_CHUNK_POINTS];
+    CharBuffer* records = results ? new CharBuffer[SWEEP_BLOCK_POINTS / SWEEP_CHUNK_POINTS] : nullptr;
+    
+    // Blocks bound the buffered output; each block is cut into small chunks
+    // that the pool balances across its workers
+    for (unsigned long long blockStart = 0; blockStart < pointCount; blockStart += SWEEP_BLOCK_POINTS) {
+        unsigned long long blockEnd = blockStart + SWEEP_BLOCK_POINTS;
+        if (blockEnd > pointCount) blockEnd = pointCount;
+        unsigned long long chunkCount = (blockEnd - blockStart + SWEEP_CHUNK_POINTS - 1) / SWEEP_CHUNK_POINTS;
+        
+        pool.parallelFor(0, chunkCount, 1, [&](unsigned long long first, unsigned long long last) {
+            for (unsigned long long c = first; c < last; ++c) {
+                unsigned long long chunkStart = blockStart + c * SWEEP_CHUNK_POINTS;
+                unsigned long long chunkEnd = chunkStart + SWEEP_CHUNK_POINTS;
+                if (chunkEnd > blockEnd) chunkEnd = blockEnd;
+                evaluateRange(chunkStart, chunkEnd, buffers[c], records ? &records[c] : nullptr);
+            }
+        });
+        
+        for (unsigned long long c = 0; c < chunkCount; ++c) {
+            buffers[c].writeTo(STDOUT);
+            buffers[c].clear();
+            if (records) {
+                results->write(records[c]);
+                records[c].clear();
+            }
+        }
+    }
+    
+    delete[] buffers;
+    delete[] records;
+}
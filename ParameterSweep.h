@@ -0,0 +1,50 @@
+// ParameterSweep.h
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include "ConfigParser.h"
+#include "CommandLine.h"
+#include "CharBuffer.h"
+#include "ThreadPool.h"
+#include "ResultEncoder.h"
+
+struct SweepAxis {
+    const char* name;
+    unsigned int nameLength;
+    unsigned int offset;        // Field offset inside SimulationConfig
+    unsigned int start;
+    unsigned int step;
+    unsigned int count;
+};
+
+// Evaluates the capacity analysis over the cartesian product of one or more
+// config key ranges. The last axis varies fastest. Points are evaluated in
+// parallel blocks, each analysed as a CapacityBatch, and written as CSV rows
+// in point order. With a ResultEncoder every point and generation also
+// becomes one result record, in the same order.
+class ParameterSweep {
+private:
+    SimulationConfig base;
+    unsigned int generations;
+    SweepAxis axes[MAX_SWEEP_AXES];
+    unsigned int axisCount;
+    unsigned long long pointCount;
+    ResultEncoder* results;
+    
+    void writeHeader(CharBuffer& out) const;
+    void decodePoint(unsigned long long point, unsigned int* digits, SimulationConfig& config) const;
+    void nextPoint(unsigned int* digits, SimulationConfig& config) const;
+    void evaluateRange(unsigned long long first, unsigned long long last, CharBuffer& out,
+                       CharBuffer* records) const;
+    
+public:
+    ParameterSweep(const SimulationConfig& baseConfig, unsigned int generationMask);
+    
+    void addAxis(const char* spec);
+    void setResults(ResultEncoder* encoder) { results = encoder; }
+    unsigned long long getPointCount() const { return pointCount; }
+    
+    void run(ThreadPool& pool) const;
+};
+
+#endif
@@ -0,0 +1,211 @@
+// ResultEncoder.cpp
+#include "ResultEncoder.h"
+
+extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
+
+#define SYS_OPEN 2
+#define SYS_CLOSE 3
+#define O_WRONLY 01
+#define O_CREAT 0100
+#define O_TRUNC 01000
+#define RESULT_FILE_MODE 0644
+
+// The shared buffer is written once it holds this much
+#define RESULT_FLUSH_BYTES (1u << 20)
+
+static const char CSV_HEADER[] =
+    "generation,point,requested,tower_capacity,frequency_limit,core_limit,"
+    "cores_needed,multi_core_limit,accepted,rejected,first_channel\n";
+
+ResultEncoder::ResultEncoder(const char* path, ResultFormat resultFormat)
+    : fd(-1), format(resultFormat) {
+    long opened = syscall3(SYS_OPEN, (long)path, O_WRONLY | O_CREAT | O_TRUNC, RESULT_FILE_MODE);
+    if (opened < 0) {
+        throw "Cannot open results file";
+    }
+    fd = (int)opened;
+
+    if (format == RESULTS_CSV) {
+        pending.append(CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    } else if (format == RESULTS_BINARY) {
+        ResultFileHeader header = { RESULT_MAGIC, RESULT_VERSION, sizeof(ResultRecord), 0 };
+        pending.append((const char*)&header, sizeof(header));
+    }
+}
+
+ResultEncoder::~ResultEncoder() {
+    flushPending();
+    syscall3(SYS_CLOSE, fd, 0, 0);
+}
+
+void ResultEncoder::flushPending() {
+    if (!pending.isEmpty()) {
+        pending.writeTo(fd);
+        pending.clear();
+    }
+}
+
+static void appendNumber(CharBuffer& out, unsigned long long value) {
+    char digits[24];
+    unsigned int len = 0;
+    do {
+        digits[sizeof(digits) - 1 - len++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    out.append(digits + sizeof(digits) - len, len);
+}
+
+// Device IDs of the tower's first channel, grouped by antenna the way the
+// report groups them. Antennas are closed with close and separated with
+// antennaSeparator, IDs with idSeparator.
+template<typename View>
+static void appendAntennaGroups(CharBuffer& out, const View& view, const char* open,
+                                const char* close, const char* antennaSeparator,
+                                const char* idSeparator) {
+    for (unsigned int ant = 0; ant < view.getAntennaCount(); ++ant) {
+        if (ant > 0) out.append(antennaSeparator);
+        out.append(open);
+        const unsigned int count = view.getUserCount(ant);
+        for (unsigned int i = 0; i < count; ++i) {
+            if (i > 0) out.append(idSeparator);
+            out.append(view.getDeviceId(ant, i));
+        }
+        out.append(close);
+    }
+}
+
+static void appendFirstChannel(CharBuffer& out, const CellTower* tower, const char* open,
+                               const char* close, const char* antennaSeparator,
+                               const char* idSeparator) {
+    appendAntennaGroups(out, AntennaView<DevicePool>(*tower->getChannel(0)), open, close,
+                        antennaSeparator, idSeparator);
+}
+
+static void appendFirstChannel(CharBuffer& out, const LazyTower* tower, const char* open,
+                               const char* close, const char* antennaSeparator,
+                               const char* idSeparator) {
+    appendAntennaGroups(out, tower->getChannelView(0), open, close, antennaSeparator, idSeparator);
+}
+
+static unsigned int firstChannelUsers(const CellTower* tower) {
+    return tower->getChannel(0)->getCurrentUsers();
+}
+
+static unsigned int firstChannelUsers(const LazyTower* tower) {
+    return tower->getChannelUsers(0);
+}
+
+template<typename Tower>
+void ResultEncoder::encodeRecord(CharBuffer& out, unsigned int generation, unsigned long long point,
+                                 const CapacityResult& r, const Tower* tower) const {
+    const bool haveChannel = tower && tower->getChannelCount() > 0;
+
+    if (format == RESULTS_BINARY) {
+        ResultRecord record;
+        record.generation = generation;
+        record.firstChannelUsers = haveChannel ? firstChannelUsers(tower) : 0;
+        record.point = point;
+        record.requested = r.accepted + r.rejected;
+        record.towerCapacity = r.towerCapacity;
+        record.frequencyLimit = r.frequencyLimit;
+        record.coreLimit = r.coreLimit;
+        record.coresNeeded = r.coresNeeded;
+        record.multiCoreLimit = r.multiCoreLimit;
+        record.accepted = r.accepted;
+        record.rejected = r.rejected;
+        out.append((const char*)&record, sizeof(record));
+        return;
+    }
+
+    if (format == RESULTS_CSV) {
+        out.append(generation);
+        out.append("G,", 2);
+        appendNumber(out, point);
+        out.append(",", 1);
+        out.append(r.accepted + r.rejected);
+        out.append(",", 1);
+        out.append(r.towerCapacity);
+        out.append(",", 1);
+        out.append(r.frequencyLimit);
+        out.append(",", 1);
+        out.append(r.coreLimit);
+        out.append(",", 1);
+        out.append(r.coresNeeded);
+        out.append(",", 1);
+        out.append(r.multiCoreLimit);
+        out.append(",", 1);
+        out.append(r.accepted);
+        out.append(",", 1);
+        out.append(r.rejected);
+        out.append(",", 1);
+        if (haveChannel) {
+            appendFirstChannel(out, tower, "", "", "|", " ");
+        }
+        out.newline();
+        return;
+    }
+
+    out.append("{\"generation\":\"");
+    out.append(generation);
+    out.append("G\",\"point\":");
+    appendNumber(out, point);
+    out.append(",\"requested\":");
+    out.append(r.accepted + r.rejected);
+    out.append(",\"tower_capacity\":");
+    out.append(r.towerCapacity);
+    out.append(",\"frequency_limit\":");
+    out.append(r.frequencyLimit);
+    out.append(",\"core_limit\":");
+    out.append(r.coreLimit);
+    out.append(",\"cores_needed\":");
+    out.append(r.coresNeeded);
+    out.append(",\"multi_core_limit\":");
+    out.append(r.multiCoreLimit);
+    out.append(",\"accepted\":");
+    out.append(r.accepted);
+    out.append(",\"rejected\":");
+    out.append(r.rejected);
+    if (haveChannel) {
+        out.append(",\"first_channel\":[");
+        appendFirstChannel(out, tower, "[", "]", ",", ",");
+        out.append("]");
+    }
+    out.append("}");
+    out.newline();
+}
+
+void ResultEncoder::encode(CharBuffer& out, unsigned int generation, unsigned long long point,
+                           const CapacityResult& result, const CellTower* tower) const {
+    encodeRecord(out, generation, point, result, tower);
+}
+
+void ResultEncoder::encode(CharBuffer& out, unsigned int generation, unsigned long long point,
+                           const CapacityResult& result, const LazyTower* tower) const {
+    encodeRecord(out, generation, point, result, tower);
+}
+
+template<typename Tower>
+void ResultEncoder::recordShared(unsigned int generation, unsigned long long point,
+                                 const CapacityResult& result, const Tower* tower) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    encodeRecord(pending, generation, point, result, tower);
+    if (pending.size() >= RESULT_FLUSH_BYTES) {
+        flushPending();
+    }
+}
+
+void ResultEncoder::record(unsigned int generation, unsigned long long point,
+                           const CapacityResult& result, const CellTower* tower) {
+    recordShared(generation, point, result, tower);
+}
+
+void ResultEncoder::record(unsigned int generation, unsigned long long point,
+                           const CapacityResult& result, const LazyTower* tower) {
+    recordShared(generation, point, result, tower);
+}
+
+void ResultEncoder::write(const CharBuffer& records) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    flushPending();
+    records.writeTo(fd);
+}
@@ -0,0 +1,90 @@
+// ResultEncoder.h
+#ifndef RESULTENCODER_H
+#define RESULTENCODER_H
+
+#include "Capacity.h"
+#include "CellTower.h"
+#include "CharBuffer.h"
+#include <mutex>
+
+enum ResultFormat {
+    RESULTS_CSV,        // One row per record, device lists as "1 5 9|2 6"
+    RESULTS_JSONL,      // One JSON object per line
+    RESULTS_BINARY      // Fixed-width ResultRecord after a ResultFileHeader
+};
+
+#define RESULT_MAGIC 0x52534E43u    // "CNSR" in a little-endian file
+#define RESULT_VERSION 1
+
+// Layout of the binary format; every field is little-endian
+struct ResultFileHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int recordSize;
+    unsigned int reserved;
+};
+
+struct ResultRecord {
+    unsigned int generation;            // 2 - 5
+    unsigned int firstChannelUsers;     // The lists themselves are text-only
+    unsigned long long point;           // Sweep point, 0 for a single run
+    unsigned int requested;
+    unsigned int towerCapacity;
+    unsigned int frequencyLimit;
+    unsigned int coreLimit;
+    unsigned int coresNeeded;
+    unsigned int multiCoreLimit;
+    unsigned int accepted;
+    unsigned int rejected;
+};
+
+// Machine-readable results written next to the human report. Records are
+// encoded straight from the CapacityResult (and the tower, for the device
+// lists of its first channel) into a CharBuffer and written to the results
+// file in large writev calls. record() may be called from several threads;
+// records then appear in completion order, the generation field tells
+// them apart.
+class ResultEncoder {
+private:
+    int fd;
+    ResultFormat format;
+    CharBuffer pending;
+    std::mutex pendingMutex;
+
+    void flushPending();
+
+    template<typename Tower>
+    void encodeRecord(CharBuffer& out, unsigned int generation, unsigned long long point,
+                      const CapacityResult& result, const Tower* tower) const;
+    template<typename Tower>
+    void recordShared(unsigned int generation, unsigned long long point,
+                      const CapacityResult& result, const Tower* tower);
+
+public:
+    // Creates or truncates the file and writes the CSV header or the
+    // binary file header
+    ResultEncoder(const char* path, ResultFormat resultFormat);
+    ~ResultEncoder();
+
+    ResultEncoder(const ResultEncoder&) = delete;
+    ResultEncoder& operator=(const ResultEncoder&) = delete;
+
+    ResultFormat getFormat() const { return format; }
+
+    // Appends one record to out; sweeps have no towers and pass none
+    void encode(CharBuffer& out, unsigned int generation, unsigned long long point,
+                const CapacityResult& result, const CellTower* tower = nullptr) const;
+    void encode(CharBuffer& out, unsigned int generation, unsigned long long point,
+                const CapacityResult& result, const LazyTower* tower) const;
+
+    // Encodes one record into the shared buffer, written once it is large
+    void record(unsigned int generation, unsigned long long point,
+                const CapacityResult& result, const CellTower* tower);
+    void record(unsigned int generation, unsigned long long point,
+                const CapacityResult& result, const LazyTower* tower);
+
+    // Writes records a caller encoded itself, after everything pending
+    void write(const CharBuffer& records);
+};
+
+#endif
@@ -67,4 +67,39 @@ char* my_strcat(char* dest, const char* src) {
     
     *dest = '\0';
     return original;
-}
\ No newline at end of file
+}
+
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes the decimal digits of value to out (not terminated), two digits
+// per step from a lookup table. out needs room for 10 characters.
+unsigned int my_utoa(unsigned int value, char* out) {
+    unsigned int len = 1;
+    for (unsigned int v = value; v >= 10; v /= 10) len++;
+    
+    unsigned int pos = len;
+    while (value >= 100) {
+        unsigned int pair = (value % 100) * 2;
+        value /= 100;
+        out[--pos] = DIGIT_PAIRS[pair + 1];
+        out[--pos] = DIGIT_PAIRS[pair];
+    }
+    if (value >= 10) {
+        out[--pos] = DIGIT_PAIRS[value * 2 + 1];
+        out[--pos] = DIGIT_PAIRS[value * 2];
+    } else {
+        out[--pos] = '0' + value;
+    }
+    
+    return len;
+}
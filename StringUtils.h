@@ -7,5 +7,6 @@ char* my_strcpy(char* dest, const char* src);
 int my_strcmp(const char* str1, const char* str2);
 const char* my_strstr(const char* haystack, const char* needle);
 char* my_strcat(char* dest, const char* src);
+unsigned int my_utoa(unsigned int value, char* out);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,180 @@
+// ThreadPool.cpp
+#include "ThreadPool.h"
+
+// Yields a waiting thread makes before it sleeps on the condition variable
+#define WAIT_SPIN_ROUNDS 256
+
+// Which pool and queue the current thread works for, if any
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local unsigned int currentQueue = 0;
+
+WorkQueue::WorkQueue() : capacity(64), top(0), bottom(0) {
+    tasks = new PoolTask[capacity];
+}
+
+WorkQueue::~WorkQueue() {
+    delete[] tasks;
+}
+
+void WorkQueue::push(const PoolTask& task) {
+    std::lock_guard<std::mutex> guard(lock);
+    
+    if (bottom - top == capacity) {
+        PoolTask* grown = new PoolTask[capacity * 2];
+        for (unsigned int i = top; i != bottom; ++i) {
+            grown[i - top] = tasks[i % capacity];
+        }
+        delete[] tasks;
+        tasks = grown;
+        bottom -= top;
+        top = 0;
+        capacity *= 2;
+    }
+    
+    tasks[bottom % capacity] = task;
+    bottom++;
+}
+
+bool WorkQueue::pop(PoolTask& task) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (bottom == top) return false;
+    
+    bottom--;
+    task = tasks[bottom % capacity];
+    return true;
+}
+
+bool WorkQueue::steal(PoolTask& task) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (bottom == top) return false;
+    
+    task = tasks[top % capacity];
+    top++;
+    return true;
+}
+
+ThreadPool::ThreadPool(unsigned int threads)
+    : queuedTasks(0), nextQueue(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+    }
+    
+    workerCount = threads;
+    queues = new WorkQueue[workerCount + 1];
+    workers = new std::thread[workerCount];
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers[i] = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers[i].join();
+    }
+    delete[] workers;
+    delete[] queues;
+}
+
+// Workers use their own queue; every other thread shares the extra one
+unsigned int ThreadPool::homeQueue() const {
+    return (currentPool == this) ? currentQueue : workerCount;
+}
+
+void ThreadPool::submit(TaskGroup& group, void (*run)(void*), void* arg) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    
+    PoolTask task;
+    task.run = run;
+    task.arg = arg;
+    task.pending = &group.pending;
+    queues[homeQueue()].push(task);
+    
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queuedTasks.fetch_add(1, std::memory_order_release);
+    }
+    wakeup.notify_one();
+}
+
+bool ThreadPool::findTask(unsigned int home, PoolTask& task) {
+    if (queues[home].pop(task)) {
+        queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    // Steal starting at a rotating victim so contention spreads out
+    unsigned int queueCount = workerCount + 1;
+    unsigned int start = nextQueue.fetch_add(1, std::memory_order_relaxed);
+    for (unsigned int i = 0; i < queueCount; ++i) {
+        unsigned int victim = (start + i) % queueCount;
+        if (victim != home && queues[victim].steal(task)) {
+            queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+// The last task of a group wakes a caller blocked in wait(); the group
+// itself may be gone once pending reaches zero, so it is not touched after
+void ThreadPool::execute(PoolTask& task) {
+    task.run(task.arg);
+    if (task.pending->fetch_sub(1, std::memory_order_release) == 1) {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+        }
+        wakeup.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    currentPool = this;
+    currentQueue = index;
+    
+    while (true) {
+        PoolTask task;
+        if (findTask(index, task)) {
+            execute(task);
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wakeup.wait(guard, [this]() {
+            return stopping || queuedTasks.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && queuedTasks.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+// The waiting thread helps with queued work. With nothing to help with it
+// spins briefly, for short subtasks, and then sleeps until the group is
+// done or new work is queued, so a long task does not keep it busy.
+void ThreadPool::wait(TaskGroup& group) {
+    unsigned int home = homeQueue();
+    unsigned int idleRounds = 0;
+    while (!group.isDone()) {
+        PoolTask task;
+        if (findTask(home, task)) {
+            execute(task);
+            idleRounds = 0;
+        } else if (idleRounds < WAIT_SPIN_ROUNDS) {
+            idleRounds++;
+            std::this_thread::yield();
+        } else {
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wakeup.wait(guard, [this, &group]() {
+                return group.isDone() || queuedTasks.load(std::memory_order_acquire) > 0;
+            });
+            idleRounds = 0;
+        }
+    }
+}
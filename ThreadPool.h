@@ -0,0 +1,125 @@
+// ThreadPool.h
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Tasks are a plain function pointer plus argument; no allocation per task
+struct PoolTask {
+    void (*run)(void* arg);
+    void* arg;
+    std::atomic<unsigned int>* pending;
+};
+
+// Counts outstanding tasks so a caller can wait for exactly its own work
+class TaskGroup {
+private:
+    std::atomic<unsigned int> pending;
+    friend class ThreadPool;
+    
+public:
+    TaskGroup() : pending(0) {}
+    bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Double-ended queue owned by one worker. The owner pushes and pops at the
+// bottom (LIFO, cache-warm); idle workers steal from the top (FIFO).
+class WorkQueue {
+private:
+    std::mutex lock;
+    PoolTask* tasks;
+    unsigned int capacity;
+    unsigned int top;
+    unsigned int bottom;
+    
+public:
+    WorkQueue();
+    ~WorkQueue();
+    
+    WorkQueue(const WorkQueue&) = delete;
+    WorkQueue& operator=(const WorkQueue&) = delete;
+    
+    void push(const PoolTask& task);
+    bool pop(PoolTask& task);
+    bool steal(PoolTask& task);
+};
+
+// Work-stealing pool sized to the hardware. Threads that wait on a
+// TaskGroup run queued tasks themselves, so tasks may submit and wait for
+// subtasks without deadlocking.
+class ThreadPool {
+private:
+    unsigned int workerCount;
+    WorkQueue* queues;          // One per worker plus one for outside threads
+    std::thread* workers;
+    
+    std::mutex sleepLock;
+    std::condition_variable wakeup;
+    std::atomic<unsigned int> queuedTasks;
+    std::atomic<unsigned int> nextQueue;
+    bool stopping;
+    
+    void workerLoop(unsigned int index);
+    bool findTask(unsigned int home, PoolTask& task);
+    void execute(PoolTask& task);
+    unsigned int homeQueue() const;
+    
+public:
+    explicit ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    unsigned int getWorkerCount() const { return workerCount; }
+    
+    void submit(TaskGroup& group, void (*run)(void*), void* arg);
+    void wait(TaskGroup& group);
+    
+    // Splits [begin, end) into chunks of at most grain items and calls
+    // body(first, last) for each chunk across the pool
+    template<typename Body>
+    void parallelFor(unsigned long long begin, unsigned long long end,
+                     unsigned long long grain, const Body& body);
+};
+
+template<typename Body>
+struct ParallelForChunk {
+    const Body* body;
+    unsigned long long first;
+    unsigned long long last;
+    
+    static void run(void* arg) {
+        ParallelForChunk* chunk = (ParallelForChunk*)arg;
+        (*chunk->body)(chunk->first, chunk->last);
+    }
+};
+
+template<typename Body>
+void ThreadPool::parallelFor(unsigned long long begin, unsigned long long end,
+                             unsigned long long grain, const Body& body) {
+    if (begin >= end) return;
+    if (grain == 0) grain = 1;
+    
+    unsigned long long chunkCount = (end - begin + grain - 1) / grain;
+    if (chunkCount == 1) {
+        body(begin, end);
+        return;
+    }
+    
+    ParallelForChunk<Body>* chunks = new ParallelForChunk<Body>[chunkCount];
+    TaskGroup group;
+    for (unsigned long long c = 0; c < chunkCount; ++c) {
+        chunks[c].body = &body;
+        chunks[c].first = begin + c * grain;
+        chunks[c].last = (chunks[c].first + grain < end) ? chunks[c].first + grain : end;
+        submit(group, &ParallelForChunk<Body>::run, &chunks[c]);
+    }
+    wait(group);
+    delete[] chunks;
+}
+
+#endif
@@ -1,45 +1,65 @@
 // UserDevice.cpp
 #include "UserDevice.h"
-#include "StringUtils.h"
+#include "DevicePool.h"
 #include "basicIO.h"
 
-UserDevice::UserDevice(unsigned int id, const char* name, unsigned int msgCount)
-    : deviceId(id), messageCount(msgCount), active(false), assignedChannel(0), frequency(0) {
-    
-    unsigned int nameLen = my_strlen(name);
-    deviceName = new char[nameLen + 1];
-    my_strcpy(deviceName, name);
-}
-
-UserDevice::~UserDevice() {
-    delete[] deviceName;
+UserDevice::UserDevice(DevicePool* devicePool, unsigned int deviceIndex)
+    : pool(devicePool), index(deviceIndex) {
+    deviceName[0] = '\0';
 }
 
+// Keeps the stored slot, which the tower needs to release the device
 void UserDevice::assignToChannel(unsigned int channel, unsigned int freq) {
-    assignedChannel = channel;
-    frequency = freq;
+    pool->assignToChannel(index, channel, freq, pool->getAssignedSlot(index));
 }
 
 void UserDevice::activate() {
-    active = true;
+    pool->activate(index);
 }
 
 void UserDevice::deactivate() {
-    active = false;
+    pool->deactivate(index);
+}
+
+unsigned int UserDevice::getDeviceId() const {
+    return pool->getDeviceId(index);
+}
+
+const char* UserDevice::getDeviceName() const {
+    if (deviceName[0] == '\0') {
+        pool->formatDeviceName(index, deviceName);
+    }
+    return deviceName;
+}
+
+bool UserDevice::isActive() const {
+    return pool->isActive(index);
+}
+
+unsigned int UserDevice::getAssignedChannel() const {
+    return pool->getAssignedChannel(index);
+}
+
+unsigned int UserDevice::getFrequency() const {
+    return pool->getFrequency(index);
+}
+
+unsigned int UserDevice::getMessageCount() const {
+    return pool->getMessageCount(index);
 }
 
 void UserDevice::displayDeviceInfo() const {
     io.outputstring("Device ID: ");
-    io.outputint(deviceId);
+    io.outputint(getDeviceId());
     io.outputstring(", Name: ");
-    io.outputstring(deviceName);
+    io.outputstring(getDeviceName());
     io.outputstring(", Status: ");
-    io.outputstring(active ? "Active" : "Inactive");
+    io.outputstring(isActive() ? "Active" : "Inactive");
     io.outputstring(", Channel: ");
-    io.outputint(assignedChannel);
+    io.outputint(getAssignedChannel());
     io.outputstring(", Frequency: ");
-    io.outputint(frequency);
+    io.outputint(getFrequency());
     io.outputstring(" kHz, Messages: ");
-    io.outputint(messageCount);
+    io.outputint(getMessageCount());
     io.terminate();
-}
\ No newline at end of file
+}
@@ -2,34 +2,31 @@
 #ifndef USERDEVICE_H
 #define USERDEVICE_H
 
+class DevicePool;
+
+// Lightweight handle to one device stored in a DevicePool
 class UserDevice {
 private:
-    unsigned int deviceId;
-    char* deviceName;
-    unsigned int messageCount;
-    bool active;
-    unsigned int assignedChannel;
-    unsigned int frequency;
+    DevicePool* pool;
+    unsigned int index;
+    mutable char deviceName[24];
     
 public:
-    UserDevice(unsigned int id, const char* name, unsigned int msgCount);
-    ~UserDevice();
-    
-    UserDevice(const UserDevice&) = delete;
-    UserDevice& operator=(const UserDevice&) = delete;
+    UserDevice(DevicePool* devicePool, unsigned int deviceIndex);
     
     void assignToChannel(unsigned int channel, unsigned int freq);
     void activate();
     void deactivate();
     
-    unsigned int getDeviceId() const { return deviceId; }
-    const char* getDeviceName() const { return deviceName; }
-    bool isActive() const { return active; }
-    unsigned int getAssignedChannel() const { return assignedChannel; }
-    unsigned int getFrequency() const { return frequency; }
-    unsigned int getMessageCount() const { return messageCount; }
+    unsigned int getIndex() const { return index; }
+    unsigned int getDeviceId() const;
+    const char* getDeviceName() const;
+    bool isActive() const;
+    unsigned int getAssignedChannel() const;
+    unsigned int getFrequency() const;
+    unsigned int getMessageCount() const;
     
     void displayDeviceInfo() const;
 };
 
-#endif
\ No newline at end of file
+#endif
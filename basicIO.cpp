@@ -1,48 +1,154 @@
 // basicIO.cpp
 #include "basicIO.h"
+#include "StringUtils.h"
+#include "Instrumentation.h"
 
 extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
 
 #define SYS_WRITE 1
 #define SYS_READ 0
+#define SYS_WRITEV 20
 #define STDOUT 1
 #define STDERR 2
 #define STDIN 0
+#define EINTR 4
+
+struct IoVec {
+    const void* base;
+    unsigned long length;
+};
 
 BasicIO io;
 
+BasicIO::BasicIO() : head(0), pending(0), buffered(false) {}
+
+BasicIO::~BasicIO() {
+    flush();
+}
+
+void BasicIO::setBuffered(bool enable) {
+    if (!enable) {
+        flush();
+    }
+    buffered = enable;
+}
+
+void BasicIO::writeDirect(int fd, const char* data, unsigned int len) {
+    SIM_TIME_PHASE(PHASE_OUTPUT);
+    while (len > 0) {
+        long written = syscall3(SYS_WRITE, fd, (long)data, len);
+        SIM_COUNT(COUNTER_SYSCALLS, 1);
+        if (written == -EINTR) continue;
+        if (written <= 0) return;
+        SIM_COUNT(COUNTER_BYTES_WRITTEN, written);
+        data += written;
+        len -= (unsigned int)written;
+    }
+}
+
+// Writes everything pending in the ring plus an optional extra block using
+// as few writev calls as possible. Partial writes consume the ring first,
+// so whatever is left stays in place for the next attempt.
+void BasicIO::flushWith(const char* extra, unsigned int extraLen) {
+    SIM_TIME_PHASE(PHASE_OUTPUT);
+    while (pending > 0 || extraLen > 0) {
+        IoVec iov[3];
+        int count = 0;
+
+        unsigned int firstLen = BASICIO_BUFFER_SIZE - head;
+        if (firstLen > pending) firstLen = pending;
+        if (firstLen > 0) {
+            iov[count].base = outBuffer + head;
+            iov[count].length = firstLen;
+            count++;
+        }
+        if (pending > firstLen) {
+            iov[count].base = outBuffer;
+            iov[count].length = pending - firstLen;
+            count++;
+        }
+        if (extraLen > 0) {
+            iov[count].base = extra;
+            iov[count].length = extraLen;
+            count++;
+        }
+
+        long written = syscall3(SYS_WRITEV, STDOUT, (long)iov, count);
+        SIM_COUNT(COUNTER_SYSCALLS, 1);
+        if (written == -EINTR) continue;
+        if (written <= 0) {
+            // Nothing more can be done for a broken stdout; drop the data
+            head = 0;
+            pending = 0;
+            return;
+        }
+
+        SIM_COUNT(COUNTER_BYTES_WRITTEN, written);
+        unsigned long consumed = (unsigned long)written;
+        if (consumed >= pending) {
+            consumed -= pending;
+            head = 0;
+            pending = 0;
+            extra += consumed;
+            extraLen -= (unsigned int)consumed;
+        } else {
+            head = (head + (unsigned int)consumed) % BASICIO_BUFFER_SIZE;
+            pending -= (unsigned int)consumed;
+        }
+    }
+    head = 0;
+}
+
+void BasicIO::flush() {
+    flushWith(nullptr, 0);
+}
+
+void BasicIO::write(const char* data, unsigned int len) {
+    if (!buffered) {
+        writeDirect(STDOUT, data, len);
+        return;
+    }
+
+    // Blocks that do not fit go out together with the ring in one writev
+    if (len > BASICIO_BUFFER_SIZE - pending) {
+        flushWith(data, len);
+        return;
+    }
+
+    unsigned int tail = (head + pending) % BASICIO_BUFFER_SIZE;
+    for (unsigned int i = 0; i < len; ++i) {
+        outBuffer[tail++] = data[i];
+        if (tail == BASICIO_BUFFER_SIZE) tail = 0;
+    }
+    pending += len;
+
+    if (pending == BASICIO_BUFFER_SIZE) {
+        flush();
+    }
+}
+
 void BasicIO::outputstring(const char* str) {
     int len = 0;
     while (str[len] != '\0') len++;
-    syscall3(SYS_WRITE, STDOUT, (long)str, len);
+    write(str, len);
 }
 
 void BasicIO::outputint(int num) {
-    if (num < 0) {
-        outputchar('-');
-        num = -num;
-    }
+    char buffer[12];
+    unsigned int len = 0;
     
-    if (num == 0) {
-        outputchar('0');
-        return;
-    }
-    
-    char buffer[32];
-    int i = 0;
-    
-    while (num > 0) {
-        buffer[i++] = '0' + (num % 10);
-        num /= 10;
+    unsigned int value = (unsigned int)num;
+    if (num < 0) {
+        buffer[len++] = '-';
+        value = 0u - value;
     }
+    len += my_utoa(value, buffer + len);
     
-    while (i > 0) {
-        outputchar(buffer[--i]);
-    }
+    write(buffer, len);
 }
 
 void BasicIO::outputchar(char c) {
-    syscall3(SYS_WRITE, STDOUT, (long)&c, 1);
+    write(&c, 1);
 }
 
 void BasicIO::terminate() {
@@ -50,12 +156,18 @@ void BasicIO::terminate() {
 }
 
 void BasicIO::errorstring(const char* str) {
+    // Keep stdout and stderr interleaved in program order
+    flush();
+
     int len = 0;
     while (str[len] != '\0') len++;
-    syscall3(SYS_WRITE, STDERR, (long)str, len);
+    writeDirect(STDERR, str, len);
 }
 
 int BasicIO::inputint() {
+    // Prompts must be visible before blocking on stdin
+    flush();
+    
     char buffer[32];
     int i = 0;
     char c;
@@ -90,7 +202,9 @@ int BasicIO::inputint() {
 }
 
 char BasicIO::inputchar() {
+    flush();
+
     char c;
     syscall3(SYS_READ, STDIN, (long)&c, 1);
     return c;
-}
\ No newline at end of file
+}
@@ -2,8 +2,31 @@
 #ifndef BASICIO_H
 #define BASICIO_H
 
+#define BASICIO_BUFFER_SIZE 65536
+
 class BasicIO {
+private:
+    // Ring buffer for stdout; only used while buffered mode is enabled
+    char outBuffer[BASICIO_BUFFER_SIZE];
+    unsigned int head;
+    unsigned int pending;
+    bool buffered;
+
+    void write(const char* data, unsigned int len);
+    void writeDirect(int fd, const char* data, unsigned int len);
+    void flushWith(const char* extra, unsigned int extraLen);
+
 public:
+    BasicIO();
+    ~BasicIO();
+
+    BasicIO(const BasicIO&) = delete;
+    BasicIO& operator=(const BasicIO&) = delete;
+
+    void setBuffered(bool enable);
+    bool isBuffered() const { return buffered; }
+    void flush();
+
     void outputstring(const char* str);
     void outputint(int num);
     void outputchar(char c);
@@ -15,4 +38,4 @@ public:
 
 extern BasicIO io;
 
-#endif
\ No newline at end of file
+#endif